@@ -3,8 +3,82 @@
 #include <regex>
 #include <ranges>
 #include <algorithm>
+#include <functional>
+#include <array>
+#include <memory>
+#include <memory_resource>
+#include <string>
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <coroutine>
+#include <istream>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <tuple>
+#include <string_view>
+#include <bit>
+#include <type_traits>
 #include <cassert>
 
+// RIME_NO_SIMDを定義すると、文字クラスの判定にSIMD命令を使わない
+#if !defined(RIME_NO_SIMD) && defined(__AVX2__)
+#define RIME_SIMD_AVX2
+#endif
+#if !defined(RIME_NO_SIMD) && (defined(__SSSE3__) || defined(__AVX2__))
+#define RIME_SIMD_SSSE3
+#include <immintrin.h>
+#endif
+
+// SIMD命令を使う関数は有効な命令セットごとに別の名前空間に置き、異なるオプションでコンパイルした翻訳単位の間で定義が衝突しないようにする
+#if defined(RIME_SIMD_AVX2)
+#define RIME_SIMD_NAMESPACE simd_avx2
+#elif defined(RIME_SIMD_SSSE3)
+#define RIME_SIMD_NAMESPACE simd_ssse3
+#else
+#define RIME_SIMD_NAMESPACE simd_none
+#endif
+
+// RIME_ENABLE_MAPPED_FILEを定義すると、ファイルのメモリマップ（rime::mapped_file、rime::grep_file）を使える
+// OSのヘッダ（<windows.h>、<sys/mman.h>など）を読み込むのは、このときだけ
+#if defined(RIME_ENABLE_MAPPED_FILE)
+#include <system_error>
+#include <filesystem>
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#define RIME_DEFINED_NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#define RIME_DEFINED_WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#ifdef RIME_DEFINED_NOMINMAX
+#undef NOMINMAX
+#undef RIME_DEFINED_NOMINMAX
+#endif
+#ifdef RIME_DEFINED_WIN32_LEAN_AND_MEAN
+#undef WIN32_LEAN_AND_MEAN
+#undef RIME_DEFINED_WIN32_LEAN_AND_MEAN
+#endif
+#define RIME_MAPPED_FILE_WIN32
+#elif __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define RIME_MAPPED_FILE_POSIX
+#endif
+#endif
+
 #ifdef _MSC_VER
 #pragma warning( push )
 #pragma warning(disable : 702)
@@ -61,18 +135,31 @@ namespace rime {
   using std::ranges::end;
 
   [[noreturn]]
-  void REGEX_PATTERN_ERROR(const char* str) {
+  inline void REGEX_PATTERN_ERROR(const char* str) {
     throw str;
   }
 
   [[noreturn]]
-  void regex_error_unimplemented() {
+  inline void regex_error_unimplemented() {
     throw "Unimplemented...";
   }
 
   inline namespace concepts {
     template <typename T>
     concept regex_usable_character = std::same_as<T, char> or std::same_as<T, wchar_t>;
+
+    // 入力文字列の指定位置以降を検索するrime独自の正規表現エンジン
+    template <typename E>
+    concept regex_searcher = requires(const E& e, std::basic_string_view<typename E::char_type> input, std::size_t pos) {
+      typename E::match_type;
+      { e.search(input, pos) } -> std::same_as<typename E::match_type>;
+    };
+
+    // 検索ごとの作業領域（scratch_type）を呼び出し側で持ち回れるエンジン
+    template <typename E>
+    concept scratch_regex_searcher = regex_searcher<E> and requires(const E& e, std::basic_string_view<typename E::char_type> input, std::size_t pos, typename E::scratch_type& scratch) {
+      { e.search(input, pos, scratch) } -> std::same_as<typename E::match_type>;
+    };
   }
 
   template<regex_usable_character CharT>
@@ -109,6 +196,13 @@ namespace rime {
     static constexpr CArray character_class_escapes = LITERAL(CharT, "dDsSwW");
     static constexpr CArray control_escapes = LITERAL(CharT, "tnvfr");
     static constexpr CArray control_letters = LITERAL(CharT, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    // builtin_classの並びと対応している
+    static constexpr CArray class_names[] = {
+      LITERAL(CharT, "alnum"), LITERAL(CharT, "alpha"), LITERAL(CharT, "blank"), LITERAL(CharT, "cntrl"),
+      LITERAL(CharT, "digit"), LITERAL(CharT, "graph"), LITERAL(CharT, "lower"), LITERAL(CharT, "print"),
+      LITERAL(CharT, "punct"), LITERAL(CharT, "space"), LITERAL(CharT, "upper"), LITERAL(CharT, "xdigit"),
+      LITERAL(CharT, "w"), LITERAL(CharT, "d"), LITERAL(CharT, "s")
+    };
   };
 
   template<std::weakly_incrementable I>
@@ -131,6 +225,355 @@ namespace rime {
     return std::ranges::distance(begin(r), std::ranges::find(r, value));
   }
 
+  template<regex_usable_character CharT>
+  constexpr auto to_code(CharT c) -> std::size_t {
+    // charが符号付きの場合でも文字コードは非負の値として扱う
+    return static_cast<std::size_t>(static_cast<std::make_unsigned_t<CharT>>(c));
+  }
+
+  namespace detail {
+    // 定数式の中で使う可変長配列
+    // _GLIBCXX_DEBUGのstd::vectorは定数式で使えないので、std::allocatorから直接確保する
+    template<typename T>
+    class constexpr_vector {
+      T* m_data = nullptr;
+      std::size_t m_size = 0;
+      std::size_t m_capacity = 0;
+      // 実行時に確保先を指定された場合のみ、nullptrならstd::allocator
+      std::pmr::memory_resource* m_resource = nullptr;
+
+      constexpr auto allocate(std::size_t n) -> T* {
+        if (m_resource != nullptr) {
+          return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+        }
+        return std::allocator<T>{}.allocate(n);
+      }
+
+      constexpr void deallocate(T* p, std::size_t n) {
+        if (m_resource != nullptr) {
+          m_resource->deallocate(p, n * sizeof(T), alignof(T));
+        } else {
+          std::allocator<T>{}.deallocate(p, n);
+        }
+      }
+
+      constexpr void reallocate(std::size_t capacity) {
+        T* data = allocate(capacity);
+
+        for (std::size_t i = 0; i < m_size; ++i) {
+          std::construct_at(data + i, std::move(m_data[i]));
+          std::destroy_at(m_data + i);
+        }
+        if (m_data != nullptr) {
+          deallocate(m_data, m_capacity);
+        }
+
+        m_data = data;
+        m_capacity = capacity;
+      }
+
+    public:
+      using value_type = T;
+      using iterator = T*;
+      using const_iterator = const T*;
+
+      constexpr_vector() = default;
+
+      constexpr explicit constexpr_vector(std::size_t n, const T& value = T{}) {
+        resize(n, value);
+      }
+
+      // 領域をresourceから確保する（実行時のみ）
+      explicit constexpr_vector(std::pmr::memory_resource* resource)
+        : m_resource(resource)
+      {}
+
+      constexpr_vector(std::size_t n, const T& value, std::pmr::memory_resource* resource)
+        : m_resource(resource)
+      {
+        resize(n, value);
+      }
+
+      constexpr constexpr_vector(std::initializer_list<T> values) {
+        reserve(values.size());
+        for (const auto& v : values) push_back(v);
+      }
+
+      constexpr constexpr_vector(const constexpr_vector& other) {
+        reserve(other.m_size);
+        for (const auto& v : other) push_back(v);
+      }
+
+      constexpr constexpr_vector(constexpr_vector&& other) noexcept
+        : m_data(std::exchange(other.m_data, nullptr))
+        , m_size(std::exchange(other.m_size, 0))
+        , m_capacity(std::exchange(other.m_capacity, 0))
+        , m_resource(other.m_resource)
+      {}
+
+      constexpr auto operator=(constexpr_vector other) noexcept -> constexpr_vector& {
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_capacity, other.m_capacity);
+        std::swap(m_resource, other.m_resource);
+        return *this;
+      }
+
+      constexpr ~constexpr_vector() {
+        clear();
+        if (m_data != nullptr) {
+          deallocate(m_data, m_capacity);
+        }
+      }
+
+      constexpr void reserve(std::size_t capacity) {
+        if (m_capacity < capacity) reallocate(capacity);
+      }
+
+      template<typename... Args>
+      constexpr auto emplace_back(Args&&... args) -> T& {
+        // 引数が自身の要素を参照している場合に備えて、再確保の前に構築する
+        T value(std::forward<Args>(args)...);
+        if (m_size == m_capacity) reallocate(m_capacity == 0 ? 4 : 2 * m_capacity);
+        return *std::construct_at(m_data + m_size++, std::move(value));
+      }
+
+      constexpr void push_back(const T& value) {
+        emplace_back(value);
+      }
+
+      constexpr void push_back(T&& value) {
+        emplace_back(std::move(value));
+      }
+
+      constexpr void pop_back() {
+        std::destroy_at(m_data + --m_size);
+      }
+
+      constexpr void clear() {
+        while (m_size != 0) pop_back();
+      }
+
+      constexpr void resize(std::size_t n, const T& value = T{}) {
+        while (n < m_size) pop_back();
+        reserve(n);
+        while (m_size < n) emplace_back(value);
+      }
+
+      constexpr void assign(std::size_t n, const T& value) {
+        clear();
+        resize(n, value);
+      }
+
+      template<std::input_iterator It>
+      constexpr auto insert(const_iterator pos, It first, It last) -> iterator {
+        const auto offset = std::size_t(pos - m_data);
+        const auto old_size = m_size;
+
+        for (; first != last; ++first) emplace_back(*first);
+        std::rotate(m_data + offset, m_data + old_size, m_data + m_size);
+
+        return m_data + offset;
+      }
+
+      constexpr auto size() const noexcept -> std::size_t { return m_size; }
+      constexpr auto empty() const noexcept -> bool { return m_size == 0; }
+      constexpr auto data() noexcept -> T* { return m_data; }
+      constexpr auto data() const noexcept -> const T* { return m_data; }
+
+      constexpr auto operator[](std::size_t i) -> T& { return m_data[i]; }
+      constexpr auto operator[](std::size_t i) const -> const T& { return m_data[i]; }
+      constexpr auto back() -> T& { return m_data[m_size - 1]; }
+      constexpr auto back() const -> const T& { return m_data[m_size - 1]; }
+
+      constexpr auto begin() noexcept -> iterator { return m_data; }
+      constexpr auto end() noexcept -> iterator { return m_data + m_size; }
+      constexpr auto begin() const noexcept -> const_iterator { return m_data; }
+      constexpr auto end() const noexcept -> const_iterator { return m_data + m_size; }
+      constexpr auto rbegin() const noexcept { return std::reverse_iterator<const_iterator>(end()); }
+      constexpr auto rend() const noexcept { return std::reverse_iterator<const_iterator>(begin()); }
+
+      friend constexpr auto operator==(const constexpr_vector& lhs, const constexpr_vector& rhs) -> bool {
+        return std::ranges::equal(lhs, rhs);
+      }
+    };
+  }
+
+  // 構文木のノードの種類
+  enum class node_kind : unsigned char {
+    concatenation,      // 子の連接、子が無い場合は空文字列
+    alternation,        // 子の選言
+    character,          // 1文字、firstが文字コード
+    any,                // .
+    char_class,         // 文字クラス、[first, last)がclass_itemsの範囲、flagが否定
+    back_reference,     // firstが参照するグループ番号
+    line_begin,         // ^
+    line_end,           // $
+    word_boundary,      // \b
+    not_word_boundary,  // \B
+    capture,            // ( )、firstがグループ番号
+    group,              // (?: )
+    lookahead,          // (?= )
+    negative_lookahead, // (?! )
+    repeat              // 量指定子、[first, last]が繰り返し回数（上限無しはnpos）、flagが貪欲
+  };
+
+  // 文字クラスエスケープとPOSIXクラス
+  // 先頭からの並びはcharacter_constant::class_namesと対応している
+  enum class builtin_class : unsigned char {
+    alnum, alpha, blank, cntrl, digit, graph, lower, print, punct, space, upper, xdigit, word,
+    not_digit,
+    not_space,
+    not_word,
+    unknown
+  };
+
+  enum class class_item_kind : unsigned char {
+    range,   // [first, last]の文字範囲
+    builtin  // firstがbuiltin_class
+  };
+
+  struct class_item {
+    class_item_kind kind{};
+    std::size_t first = 0;
+    std::size_t last = 0;
+  };
+
+  struct syntax_node {
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    node_kind kind{};
+    bool flag = false;
+    std::size_t first = 0;
+    std::size_t last = 0;
+    // 最初の子と次の兄弟のインデックス
+    std::size_t child = npos;
+    std::size_t sibling = npos;
+  };
+
+  // パターン長Nから容量の決まる、定数式で保持可能な構文木
+  template<regex_usable_character CharT, std::size_t N>
+  struct syntax_tree {
+    using char_type = CharT;
+
+    // ノードは1文字につき高々2つ（グループと選言で増える分）+ ルートの連接
+    std::array<syntax_node, 2 * N + 2> nodes{};
+    std::array<class_item, N + 1> class_items{};
+    std::size_t node_count = 0;
+    std::size_t class_item_count = 0;
+    std::size_t root = syntax_node::npos;
+    std::size_t capture_group_count = 0;
+
+    constexpr auto add_node(const syntax_node& node) -> std::size_t {
+      nodes[node_count] = node;
+      return node_count++;
+    }
+
+    constexpr void append_child(std::size_t parent, std::size_t child) {
+      auto* link = &nodes[parent].child;
+      while (*link != syntax_node::npos) {
+        link = &nodes[*link].sibling;
+      }
+      *link = child;
+    }
+
+    constexpr void add_class_item(const class_item& item) {
+      class_items[class_item_count++] = item;
+    }
+
+    constexpr auto class_item_size() const -> std::size_t {
+      return class_item_count;
+    }
+
+    constexpr void set_root(std::size_t index, std::size_t group_count) {
+      root = index;
+      capture_group_count = group_count;
+    }
+  };
+
+  namespace detail {
+    // 構文チェックのみを行う時の何もしない構文木
+    struct null_tree {
+      constexpr auto add_node(const syntax_node&) -> std::size_t { return 0; }
+      constexpr void append_child(std::size_t, std::size_t) {}
+      constexpr void add_class_item(const class_item&) {}
+      constexpr auto class_item_size() const -> std::size_t { return 0; }
+      constexpr void set_root(std::size_t, std::size_t) {}
+    };
+
+    // パターン長が定数でない時に使う、可変長配列で保持する構文木
+    template<regex_usable_character CharT>
+    struct dynamic_syntax_tree {
+      using char_type = CharT;
+
+      constexpr_vector<syntax_node> nodes;
+      constexpr_vector<class_item> class_items;
+      std::size_t node_count = 0;
+      std::size_t class_item_count = 0;
+      std::size_t root = syntax_node::npos;
+      std::size_t capture_group_count = 0;
+
+      constexpr auto add_node(const syntax_node& node) -> std::size_t {
+        nodes.push_back(node);
+        return node_count++;
+      }
+
+      constexpr void append_child(std::size_t parent, std::size_t child) {
+        auto* link = &nodes[parent].child;
+        while (*link != syntax_node::npos) {
+          link = &nodes[*link].sibling;
+        }
+        *link = child;
+      }
+
+      constexpr void add_class_item(const class_item& item) {
+        class_items.push_back(item);
+        ++class_item_count;
+      }
+
+      constexpr auto class_item_size() const -> std::size_t {
+        return class_item_count;
+      }
+
+      constexpr void set_root(std::size_t index, std::size_t group_count) {
+        root = index;
+        capture_group_count = group_count;
+      }
+    };
+
+    // RIME_STRICT_BACKTRACKINGを定義すると、バックトラックで照合するエンジン（std::regex、static_regex）に
+    // 破滅的なバックトラックを起こし得るパターンを渡すとコンパイルエラーになる
+#ifdef RIME_STRICT_BACKTRACKING
+    inline constexpr bool strict_backtracking = true;
+#else
+    inline constexpr bool strict_backtracking = false;
+#endif
+
+    enum class hazard_kind : unsigned char {
+      none,
+      nested_quantifier,     // (a+)+ のように、繰り返しの中の繰り返しが次の繰り返しの先頭と同じ文字を消費できる
+      ambiguous_alternation, // (\w|\d)* のように、繰り返しの中の選択肢が同じ文字から始まる
+      overlapping_sequence   // (a?a)* のように、繰り返しの中の連接の区切り方が複数ある
+    };
+
+    // 破滅的なバックトラックの原因となるパターンの構造、nodeは外側の繰り返し
+    struct backtracking_hazard {
+      hazard_kind kind = hazard_kind::none;
+      std::size_t node = syntax_node::npos;
+
+      constexpr explicit operator bool() const noexcept {
+        return kind != hazard_kind::none;
+      }
+    };
+
+    template<typename Tree>
+    constexpr auto find_backtracking_hazard(const Tree& tree) -> backtracking_hazard;
+
+    // 破滅的なバックトラックを起こし得るパターンをエラーにする
+    template<typename Tree>
+    constexpr void check_backtracking(const Tree& tree);
+  }
+
   template<regex_usable_character CharT>
   struct pattern_check {
 
@@ -140,6 +583,20 @@ namespace rime {
     using S = std::ranges::sentinel_t<std::basic_string_view<CharT>>;
 
     fn start(std::basic_string_view<CharT> pattern) {
+      if constexpr (detail::strict_backtracking) {
+        detail::dynamic_syntax_tree<CharT> tree{};
+        parse(pattern, tree);
+        detail::check_backtracking(tree);
+      } else {
+        detail::null_tree tree{};
+        parse(pattern, tree);
+      }
+      // ここにきたらOK
+    }
+
+    // パターンをチェックしつつ、発見した構造をtreeに記録する
+    template<typename Tree>
+    static constexpr void parse(std::basic_string_view<CharT> pattern, Tree& tree) {
       auto it = pattern.begin();
       const auto fin = pattern.end();
 
@@ -147,52 +604,76 @@ namespace rime {
       // キャプチャグループは開き括弧`(`で導入される（閉じ括弧は気にしないでいい）
       std::size_t capture_group_count = 0;
 
-      disjunction(it, fin, capture_group_count);
+      const auto root = disjunction(it, fin, capture_group_count, tree);
 
       if (it != fin) {
         REGEX_PATTERN_ERROR("Parse error.");
       }
-      // ここにきたらOK
+
+      tree.set_root(root, capture_group_count);
     }
 
-    static constexpr void disjunction(I& it, const S fin, std::size_t& capture_group_count) {
-      // Alternative
-      while (it != fin) {
-        const auto c = *it;
-        if (c == chars::bitwise_or or c == chars::rparen) break;
+    fn disjunction(I& it, const S fin, std::size_t& capture_group_count, auto& tree) -> std::size_t {
+      const auto first = alternative(it, fin, capture_group_count, tree);
 
-        // Term
-        if (assertion(it, fin) == false) {
-          atom(it, fin, capture_group_count);
+      if (it == fin) return first;
 
-          if (it != fin) {
-            quantifier(it, fin);
-          }
-        }
-      }
+      if (const auto c = *it; c == chars::bitwise_or) {
+        // 2つ目以降のAlternativeを選言ノードにまとめる
+        const auto alt = tree.add_node({.kind = node_kind::alternation});
+        tree.append_child(alt, first);
 
-      if (it == fin) return;
+        do {
+          consume(it);
+          tree.append_child(alt, alternative(it, fin, capture_group_count, tree));
+        } while (it != fin and *it == chars::bitwise_or);
 
-      if (const auto c = *it; c == chars::bitwise_or) {
-        consume(it);
-        return disjunction(it, fin, capture_group_count);
+        return alt;
       } else if (c == chars::rparen) {
         // 先読みアサーションとグループ内のパース時にdisjunctionを終了する
-        return;
+        return first;
       } else {
         // ここくる？
         REGEX_PATTERN_ERROR("The expected '|' did not appear.");
       }
     }
 
-    fn assertion(I& it , const S fin) -> bool {
+    fn alternative(I& it, const S fin, std::size_t& capture_group_count, auto& tree) -> std::size_t {
+      const auto seq = tree.add_node({.kind = node_kind::concatenation});
+
+      while (it != fin) {
+        const auto c = *it;
+        if (c == chars::bitwise_or or c == chars::rparen) break;
+
+        // Term
+        if (const auto a = assertion(it, fin, tree); a != syntax_node::npos) {
+          tree.append_child(seq, a);
+          continue;
+        }
+
+        auto term = atom(it, fin, capture_group_count, tree);
+
+        if (it != fin) {
+          term = quantifier(it, fin, term, tree);
+        }
+
+        tree.append_child(seq, term);
+      }
+
+      return seq;
+    }
+
+    // アサーションでなければnposを返す
+    fn assertion(I& it , const S fin, auto& tree) -> std::size_t {
       const auto c = *it;
 
       switch (c) {
-      case chars::caret: [[fallthrough]];
+      case chars::caret:
+        consume(it);
+        return tree.add_node({.kind = node_kind::line_begin});
       case chars::dollar:
         consume(it);
-        return true;
+        return tree.add_node({.kind = node_kind::line_end});
       case chars::backslash:
         {
           auto next = it + 1;
@@ -205,7 +686,7 @@ namespace rime {
           if (c2 == chars::b or c2 == chars::B) {
             // \bの次まで消費
             consume_n(it, 2);
-            return true;
+            return tree.add_node({.kind = (c2 == chars::b) ? node_kind::word_boundary : node_kind::not_word_boundary});
           }
           /*if (c2 == chars::backslash) {
             // `\\`を消費
@@ -215,21 +696,32 @@ namespace rime {
         }
         [[fallthrough]];
       default:
-        return false;
+        return syntax_node::npos;
       }
     }
 
-    fn quantifier(I& it, const S fin) {
-      quantifier_prefix(it, fin);
+    // 量指定子があればatomを子とする繰り返しノードを、なければatomをそのまま返す
+    fn quantifier(I& it, const S fin, std::size_t atom, auto& tree) -> std::size_t {
+      const auto range = quantifier_prefix(it, fin);
+
+      if (not range) {
+        return atom;
+      }
 
+      bool greedy = true;
       if (it != fin and *it == chars::question) {
         consume(it);
+        greedy = false;
       }
 
-      return;
+      const auto rep = tree.add_node({.kind = node_kind::repeat, .flag = greedy, .first = range->first, .last = range->second});
+      tree.append_child(rep, atom);
+
+      return rep;
     }
 
-    fn quantifier_prefix(I& it, const S fin) {
+    // 量指定子の表す繰り返し回数の範囲を返す（上限無しはnpos）
+    fn quantifier_prefix(I& it, const S fin) -> std::optional<std::pair<std::size_t, std::size_t>> {
       // termの呼び出しで終端チェック済
 
       const std::input_or_output_iterator auto p = std::ranges::find(chars::quantifier_prefix_symbols, *it);
@@ -254,9 +746,10 @@ namespace rime {
               // 数字が現れる前に閉じている
               REGEX_PATTERN_ERROR(R"_(Quantifiers must have at least one number. [Example: `\d{}` ] )_");
             }
+            const std::size_t n = decode_decimal_digits(copy_it, it);
             // 数量詞終端
             consume(it);
-            return;
+            return std::pair{n, n};
           }
           if (*it != chars::comma) {
             // 数字でもカンマでも閉じかっこでもないものが現れている
@@ -286,10 +779,13 @@ namespace rime {
             REGEX_PATTERN_ERROR(R"(A ',' can appear only once in Quantifiers. [Example: `\d{0,10,2}` ] )");
           }
           if (*it == chars::rbrace) {
+            // `a{0,}`のような場合は上限無し
+            std::size_t r = syntax_node::npos;
+
             // 後半に数字がある場合、範囲チェックを行う（`a{0,}`のような場合はスキップする）
             if (it != copy_it) {
               // 右側の数字を取得
-              std::size_t r = decode_decimal_digits(copy_it, it);
+              r = decode_decimal_digits(copy_it, it);
 
               if (not (l <= r)) {
                 // 数値範囲が逆転している
@@ -299,16 +795,25 @@ namespace rime {
 
             // 数量詞終端
             consume(it);
-            return;
+            return std::pair{l, r};
           }
           // それ以外の出現はエラー
           REGEX_PATTERN_ERROR(R"_(You can't use anything but numbers within Quantifiers. [Example: `\d{0, 5}`, `\d{0,@}`, `a{1,a}` ] )_");
-          return;
         }
         consume(it);
+
+        // * + ?
+        switch (std::ranges::distance(begin(chars::quantifier_prefix_symbols), p)) {
+        case 0:
+          return std::pair{std::size_t(0), syntax_node::npos};
+        case 1:
+          return std::pair{std::size_t(1), syntax_node::npos};
+        default:
+          return std::pair{std::size_t(0), std::size_t(1)};
+        }
       }
       // * + ? { 以外は消費しないで戻る
-      return;
+      return std::nullopt;
     }
 
     fn decimal_digits(I& it, const S fin) -> std::size_t {
@@ -322,36 +827,36 @@ namespace rime {
       return count;
     }
 
-    fn atom(I& it, const S fin, std::size_t& capture_group_count) {
+    fn atom(I& it, const S fin, std::size_t& capture_group_count, auto& tree) -> std::size_t {
       const auto c = *it;
 
       switch (c) {
       case chars::dot:
         consume(it);
-        return;
+        return tree.add_node({.kind = node_kind::any});
       case chars::backslash:
-        atom_escape(it, fin, capture_group_count);
-        return;
+        return atom_escape(it, fin, capture_group_count, tree);
       case chars::lbracket:
-        character_class(it, fin);
-        return;
+        return character_class(it, fin, tree);
       case chars::lparen:
         ++capture_group_count;
-        lookahead_assertion_or_group(it, fin, capture_group_count);
-        return;
+        return lookahead_assertion_or_group(it, fin, capture_group_count, tree);
       default:
-        pattern_character(it);
-        return;
+        return pattern_character(it, tree);
       }
     }
 
-    fn lookahead_assertion_or_group(I &it, const S fin, std::size_t& capture_group_count) {
+    fn lookahead_assertion_or_group(I &it, const S fin, std::size_t& capture_group_count, auto& tree) -> std::size_t {
       consume(it);
       if (it == fin) {
         // グループが閉じていない
         REGEX_PATTERN_ERROR("The group is not closed.");
       }
 
+      auto kind = node_kind::capture;
+      // このグループの番号
+      const auto group_index = capture_group_count;
+
       // 先読みアサーションのチェック
       if (const auto c = *it; c == chars::question) {
         consume(it);
@@ -361,9 +866,13 @@ namespace rime {
         }
         const auto c2 = *it;
         if (c2 == chars::colon or c2 == chars::equal or c2 == chars::exclamation) {
+          // (?:~)のグループと先読みアサーションはカウントしない
+          --capture_group_count;
+
           if (c2 == chars::colon) {
-            // (?:~)のグループはカウントしない
-            --capture_group_count;
+            kind = node_kind::group;
+          } else {
+            kind = (c2 == chars::equal) ? node_kind::lookahead : node_kind::negative_lookahead;
           }
           consume(it);
         } else {
@@ -372,17 +881,19 @@ namespace rime {
         }
       }
 
+      const auto group = tree.add_node({.kind = kind, .first = (kind == node_kind::capture) ? group_index : 0});
+
       // グループとして一括処理
-      disjunction(it, fin, capture_group_count);
-      if (const auto c = *it; c != chars::rparen) {
+      tree.append_child(group, disjunction(it, fin, capture_group_count, tree));
+      if (it == fin or *it != chars::rparen) {
         // グループが閉じていない
         REGEX_PATTERN_ERROR("The group is not closed.");
       }
       consume(it);
-      return;
+      return group;
     }
 
-    fn pattern_character(I& it) {
+    fn pattern_character(I& it, auto& tree) -> std::size_t {
       // ^ $ \ . * + ? ( ) [ ] { } | を除いた1文字
       // | ) => 消費せずに戻る
       // * + ? { => エラー（Quantifierの開始文字）
@@ -394,14 +905,15 @@ namespace rime {
 
       if (p == e) {
         // 通常のパターン文字
+        const auto c = *it;
         consume(it);
-        return;
+        return tree.add_node({.kind = node_kind::character, .first = to_code(c), .last = to_code(c)});
       }
 
       // エラーにしない文字は後ろの方で見つかるようにしてある
       if (auto t = e - 2; t <= p) {
         // | )
-        return;
+        return syntax_node::npos;
       }
       if (auto t = e - 6; t <= p) {
         // * + ? {
@@ -429,7 +941,7 @@ namespace rime {
       identity
     };
   
-    fn atom_escape(I& it, const S fin, std::size_t& capture_group_count) {
+    fn atom_escape(I& it, const S fin, std::size_t& capture_group_count, auto& tree) -> std::size_t {
       consume(it);
       if (it == fin) {
         // 孤立したバックスラッシュ（assertionでチェックしてるのでここには来ないのでは・・・？）
@@ -447,14 +959,19 @@ namespace rime {
             // キャプチャグループ参照が出現しているものよりも大きい
             REGEX_PATTERN_ERROR("The index of the back reference must be less than or equal to the current number of capture groups.");
           }
+          return tree.add_node({.kind = node_kind::back_reference, .first = backref_index});
         }
-        return;
+        return tree.add_node({.kind = node_kind::character, .first = 0, .last = 0});
       }
       if (character_class_escape(it) == true) {
-        return;
+        // 1要素の文字クラスとして扱う
+        const auto first_item = tree.class_item_size();
+        tree.add_class_item({.kind = class_item_kind::builtin, .first = std::size_t(decode_class_escape(*it2))});
+        return tree.add_node({.kind = node_kind::char_class, .first = first_item, .last = tree.class_item_size()});
       }
-      if (character_escape(it, fin) != character_escape_result::reject) {
-        return;
+      if (const auto esc_kind = character_escape(it, fin); esc_kind != character_escape_result::reject) {
+        const auto c = decode_character_escape(esc_kind, it2, it);
+        return tree.add_node({.kind = node_kind::character, .first = c, .last = c});
       }
 
       // ここにきたらエラー？
@@ -568,14 +1085,19 @@ namespace rime {
       return false;
     }
 
-    fn character_class(I& it, const S fin) {
+    fn character_class(I& it, const S fin, auto& tree) -> std::size_t {
       consume(it);
+      bool negated = false;
       if (it != fin and *it == chars::caret) {
         consume(it);
+        negated = true;
       }
 
-      class_ranges(it, fin);
+      const auto first_item = tree.class_item_size();
+      class_ranges(it, fin, tree);
       consume(it);
+
+      return tree.add_node({.kind = node_kind::char_class, .flag = negated, .first = first_item, .last = tree.class_item_size()});
     }
 
     // class_atomがどの構文をパースして帰っているのかを伝える
@@ -586,22 +1108,26 @@ namespace rime {
     };
 
 
-    fn class_ranges(I& it, const S fin) {
+    fn class_ranges(I& it, const S fin, auto& tree) {
       for (;;) {
         // 文字範囲の最初と最後の文字を数字にして保持する
         class_atom_result first_kind{}, last_kind{};
         std::size_t first = 0, last = 0;
 
         // NonemptyClassRanges
-        if (std::tie(first_kind, first) = class_atom(it, fin); first_kind == class_atom_result::rbracket) {
+        if (std::tie(first_kind, first) = class_atom(it, fin, tree); first_kind == class_atom_result::rbracket) {
           // 空の場合
           return;
         }
 
         if (it != fin and *it == chars::hyphen) {
           consume(it);
-          if (std::tie(last_kind, last) = class_atom(it, fin); last_kind == class_atom_result::rbracket) {
-            // 続くClassRangesは空
+          if (std::tie(last_kind, last) = class_atom(it, fin, tree); last_kind == class_atom_result::rbracket) {
+            // 続くClassRangesは空、ハイフンは文字として扱う
+            if (first_kind == class_atom_result::one_char) {
+              tree.add_class_item({.kind = class_item_kind::range, .first = first, .last = first});
+            }
+            tree.add_class_item({.kind = class_item_kind::range, .first = to_code(chars::hyphen), .last = to_code(chars::hyphen)});
             return;
           }
 
@@ -610,16 +1136,23 @@ namespace rime {
             if (not (first <= last)) {
               REGEX_PATTERN_ERROR(R"_(Invalid range in character class. [Example: `[z-a]`, `[5-2]` ])_");
             }
+            tree.add_class_item({.kind = class_item_kind::range, .first = first, .last = last});
             continue;
           } else {
             // 文字範囲の開始と終端はそれぞれ1文字を示すものでなければならない
             REGEX_PATTERN_ERROR(R"_(The start and end of range of character(character class) must be specified to indicate a single character. [Example: `[\w-a]`, `[\s-\d]` ])_");
           }
         }
+
+        // 単独の1文字（文字集合はclass_atomで記録済み）
+        if (first_kind == class_atom_result::one_char) {
+          tree.add_class_item({.kind = class_item_kind::range, .first = first, .last = first});
+        }
       }
     }
 
-    fn class_atom(I& it, const S fin) -> std::pair<class_atom_result, std::size_t> {
+    // 文字集合（\d や [:digit:]等）はここでtreeに記録する
+    fn class_atom(I& it, const S fin, auto& tree) -> std::pair<class_atom_result, std::size_t> {
       if (it == fin) {
         // []が閉じていない
         REGEX_PATTERN_ERROR("The range of character(character class) is not closed.");
@@ -629,17 +1162,19 @@ namespace rime {
 
       switch (c) {
       case chars::backslash:
-        return class_escape(it, fin);
+        return class_escape(it, fin, tree);
       case chars::rbracket:
         return {class_atom_result::rbracket, 0};
       case chars::lbracket:
-        if (posix_class(it, fin) == true) {
+        if (auto it2 = it; posix_class(it, fin) == true) {
+          // [:name:] の name 部分
+          tree.add_class_item(decode_posix_class(it2 + 1, it - 2));
           return {class_atom_result::char_set, 0};
         }
         [[fallthrough]];
       default:
         consume(it);
-        return {class_atom_result::one_char, std::size_t(c)};
+        return {class_atom_result::one_char, to_code(c)};
       }
     }
 
@@ -707,7 +1242,7 @@ namespace rime {
       } while (it != fin);
     }
   
-    fn class_escape(I& it, const S fin) -> std::pair<class_atom_result, std::size_t>  {
+    fn class_escape(I& it, const S fin, auto& tree) -> std::pair<class_atom_result, std::size_t>  {
       // バックスラッシュを消費
       consume(it);
       if (it == fin) {
@@ -717,6 +1252,8 @@ namespace rime {
 
       if (*it == chars::b) {
         consume(it);
+        // []の中の\bはバックスペース
+        tree.add_class_item({.kind = class_item_kind::range, .first = 8, .last = 8});
         return {class_atom_result::char_set, 0};
       }
       if (const auto dec_escape_kind = decimal_escape(it, fin); dec_escape_kind != decimal_escape_result::reject) {
@@ -727,7 +1264,8 @@ namespace rime {
         // DecimalEscapeの後方参照は禁止
         REGEX_PATTERN_ERROR("You cannot back reference in [].");
       }
-      if (character_class_escape(it) == true) {
+      if (auto it2 = it; character_class_escape(it) == true) {
+        tree.add_class_item({.kind = class_item_kind::builtin, .first = std::size_t(decode_class_escape(*it2))});
         return {class_atom_result::char_set, 0};
       }
 
@@ -735,35 +1273,78 @@ namespace rime {
       // エラーになっていなければ、バックスラッシュの次の文字を指している
       auto it2 = it;
       if (const auto esc_kind = character_escape(it, fin); esc_kind != character_escape_result::reject) {
-        switch (esc_kind) {
-        case character_escape_result::control :
-          // \f \n \r \t \v
-          return {class_atom_result::one_char, decode_control(*it2)};
-        case character_escape_result::control_letter :
-          // \c の後にアルファベット1文字
-          // キャレット記法によってASCII制御文字にマッチする
-          consume(it2);
-          return {class_atom_result::one_char, decode_caret_notation(*it2)};
-        case character_escape_result::hex :
-          // 16進エスケープ、\xhh
-          consume(it2);
-          return {class_atom_result::one_char, decode_hex_digits(it2, it, false)};
-        case character_escape_result::unicode :
-          // ユニコードエスケープ、\uhhhh
-          consume(it2);
-          return {class_atom_result::one_char, decode_hex_digits(it2, it, true)};
-        case character_escape_result::identity :
-          // バックスラッシュの後に任意の1文字
-          return {class_atom_result::one_char, std::size_t(*it2)};
-        default:
-          return {class_atom_result::char_set, 0};
-        }
+        return {class_atom_result::one_char, decode_character_escape(esc_kind, it2, it)};
       }
 
       // ここにきたらエラー？
       REGEX_PATTERN_ERROR("There's an unknown escape sequence.");
     }
 
+    // [first, last)のCharacterEscapeをデコードする、firstはバックスラッシュの次の文字を指している
+    fn decode_character_escape(character_escape_result esc_kind, I first, const I last) -> std::size_t {
+      switch (esc_kind) {
+      case character_escape_result::control :
+        // \f \n \r \t \v
+        return decode_control(*first);
+      case character_escape_result::control_letter :
+        // \c の後にアルファベット1文字
+        // キャレット記法によってASCII制御文字にマッチする
+        consume(first);
+        return decode_caret_notation(*first);
+      case character_escape_result::hex :
+        // 16進エスケープ、\xhh
+        consume(first);
+        return decode_hex_digits(first, last, false);
+      case character_escape_result::unicode :
+        // ユニコードエスケープ、\uhhhh
+        consume(first);
+        return decode_hex_digits(first, last, true);
+      case character_escape_result::identity :
+        // バックスラッシュの後に任意の1文字
+        return to_code(*first);
+      default:
+        REGEX_PATTERN_ERROR("Unreachable");
+      }
+    }
+
+    fn decode_class_escape(CharT c) -> builtin_class {
+      // dDsSwWの順で並んでいる
+      constexpr builtin_class classes[] = {
+        builtin_class::digit, builtin_class::not_digit,
+        builtin_class::space, builtin_class::not_space,
+        builtin_class::word, builtin_class::not_word
+      };
+
+      return classes[char_to_num(chars::character_class_escapes, c)];
+    }
+
+    // firstはPOSIXクラスの導入文字（: = .）を指していて、[first + 1, last)が名前
+    fn decode_posix_class(I first, const I last) -> class_item {
+      const auto introducer = *first;
+      consume(first);
+      const std::basic_string_view<CharT> name(first, last);
+
+      if (introducer != chars::colon) {
+        // [=a=] [.a.] は1文字ならその文字として扱う
+        if (name.size() == 1) {
+          return {.kind = class_item_kind::range, .first = to_code(name[0]), .last = to_code(name[0])};
+        }
+        return {.kind = class_item_kind::builtin, .first = std::size_t(builtin_class::unknown)};
+      }
+
+      // w d s の3つは別名
+      constexpr builtin_class aliases[] = { builtin_class::word, builtin_class::digit, builtin_class::space };
+
+      const auto n = char_to_num(chars::class_names, name);
+      if (n < std::size_t(builtin_class::word)) {
+        return {.kind = class_item_kind::builtin, .first = n};
+      }
+      if (n < std::ranges::size(chars::class_names)) {
+        return {.kind = class_item_kind::builtin, .first = std::size_t(aliases[n - std::size_t(builtin_class::word)])};
+      }
+      return {.kind = class_item_kind::builtin, .first = std::size_t(builtin_class::unknown)};
+    }
+
     fn decode_control(CharT c) -> std::size_t {
       // control_escapesでの位置を求める
       // tnvfrの順で並んでいる
@@ -779,8 +1360,8 @@ namespace rime {
       // chars::control_lettersでの位置を求め先頭からの距離を求める
       std::size_t n = char_to_num(chars::control_letters, c);
 
-      // 大文字なら25を引く事で小文字と一貫させる
-      if (std::cmp_less(25, n)) n -= 25;
+      // 大文字なら26を引く事で小文字と一貫させる
+      if (std::cmp_less(25, n)) n -= 26;
 
       // 先頭からの相対位置（0始まり）が制御文字のコードに対応する
       // 0始まりなので+1する
@@ -788,7 +1369,8 @@ namespace rime {
     }
 
     fn decode_hex_digits(I it, const S fin, bool is_unicode_escs) -> std::size_t {
-      std::size_t coeff = 16 * 16;
+      // 先頭の桁の重み
+      std::size_t coeff = 16;
       if (is_unicode_escs) {
         // ユニコードエスケープシーケンスは4桁
         coeff *= 16 * 16;
@@ -831,6 +1413,39 @@ namespace rime {
     }
   };
 
+  // パターン文字列をテンプレート引数として受け取るための構造的型
+  template<regex_usable_character CharT, std::size_t N>
+  struct fixed_string {
+    using char_type = CharT;
+
+    // 終端のナル文字を含む
+    CharT str[N]{};
+
+    constexpr fixed_string(const CharT (&s)[N]) {
+      std::ranges::copy(s, str);
+    }
+
+    static constexpr auto size() -> std::size_t {
+      return N - 1;
+    }
+
+    constexpr auto view() const -> std::basic_string_view<CharT> {
+      return {str, N - 1};
+    }
+  };
+
+  // パターンをチェックし、その構文木を返す
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  consteval auto parse() {
+    using CharT = typename decltype(Pattern)::char_type;
+
+    syntax_tree<CharT, Pattern.size()> tree{};
+    pattern_check<CharT>::parse(Pattern.view(), tree);
+
+    return tree;
+  }
+
   inline namespace literals {
 
     [[nodiscard]]
@@ -863,12 +1478,12 @@ namespace rime {
 
   [[nodiscard]]
   inline auto regex(detail::regex_pattern_str<char> pattern) -> std::regex {
-    return std::basic_regex<char>(pattern.str.data());
+    return std::basic_regex<char>(pattern.str.data(), pattern.str.size());
   }
 
   [[nodiscard]]
   inline auto regex(detail::regex_pattern_str<wchar_t> pattern) -> std::wregex {
-    return std::basic_regex<wchar_t>(pattern.str.data());
+    return std::basic_regex<wchar_t>(pattern.str.data(), pattern.str.size());
   }
 
   template<regex_usable_character CharT>
@@ -879,34 +1494,5408 @@ namespace rime {
 
     return subrange{reiter_t{begin(input_str), end(input_str), re}, reiter_t{}};
   }
-}
 
-namespace rime::ranges {
+  namespace detail {
+    constexpr auto is_digit_code(std::size_t c) -> bool {
+      return 0x30 <= c and c <= 0x39;
+    }
 
-  template<std::ranges::view V, typename CharT = char>
-  class regex_filter_view : public std::ranges::view_interface<regex_filter_view<V, CharT>> {
-    V m_view;
-    std::basic_regex<CharT> m_regex;
+    constexpr auto is_upper_code(std::size_t c) -> bool {
+      return 0x41 <= c and c <= 0x5A;
+    }
 
-    regex_filter_view(V view, std::basic_regex<CharT> regex)
-      : m_view(std::move(view))
-      , m_regex(std::move(regex))
-    {}
+    constexpr auto is_lower_code(std::size_t c) -> bool {
+      return 0x61 <= c and c <= 0x7A;
+    }
 
+    constexpr auto is_word_code(std::size_t c) -> bool {
+      return is_digit_code(c) or is_upper_code(c) or is_lower_code(c) or c == 0x5F;
+    }
 
-  };
+    constexpr auto is_space_code(std::size_t c) -> bool {
+      // ' ' \t \n \v \f \r
+      return c == 0x20 or (0x09 <= c and c <= 0x0D);
+    }
 
-  template<typename R, typename CharT>
-  regex_filter_view(R&&, std::basic_regex<CharT>&&) -> regex_filter_view<std::views::all_t<R>, CharT>;
+    // .がマッチしない文字
+    constexpr auto is_line_terminator_code(std::size_t c) -> bool {
+      return c == 0x0A or c == 0x0D or c == 0x2028 or c == 0x2029;
+    }
+
+    // 文字クラスエスケープとPOSIXクラスの判定、std::regexの"C"ロケールでの振る舞いに合わせてASCIIの範囲で判定する
+    constexpr auto builtin_contains(builtin_class cls, std::size_t c) -> bool {
+      const bool graph = 0x21 <= c and c <= 0x7E;
+
+      switch (cls) {
+      case builtin_class::alnum:
+        return is_digit_code(c) or is_upper_code(c) or is_lower_code(c);
+      case builtin_class::alpha:
+        return is_upper_code(c) or is_lower_code(c);
+      case builtin_class::blank:
+        return c == 0x20 or c == 0x09;
+      case builtin_class::cntrl:
+        return c < 0x20 or c == 0x7F;
+      case builtin_class::digit:
+        return is_digit_code(c);
+      case builtin_class::graph:
+        return graph;
+      case builtin_class::lower:
+        return is_lower_code(c);
+      case builtin_class::print:
+        return graph or c == 0x20;
+      case builtin_class::punct:
+        return graph and not (is_digit_code(c) or is_upper_code(c) or is_lower_code(c));
+      case builtin_class::space:
+        return is_space_code(c);
+      case builtin_class::upper:
+        return is_upper_code(c);
+      case builtin_class::xdigit:
+        return is_digit_code(c) or (0x41 <= c and c <= 0x46) or (0x61 <= c and c <= 0x66);
+      case builtin_class::word:
+        return is_word_code(c);
+      case builtin_class::not_digit:
+        return not is_digit_code(c);
+      case builtin_class::not_space:
+        return not is_space_code(c);
+      case builtin_class::not_word:
+        return not is_word_code(c);
+      default:
+        return false;
+      }
+    }
 
+    // 文字クラスノードが文字cを含むか
+    template<typename Tree>
+    constexpr auto class_contains(const Tree& tree, const syntax_node& node, std::size_t c) -> bool {
+      bool found = false;
 
+      for (auto i = node.first; i < node.last and not found; ++i) {
+        const auto& item = tree.class_items[i];
 
-  namespace views {
+        if (item.kind == class_item_kind::range) {
+          found = item.first <= c and c <= item.last;
+        } else {
+          found = builtin_contains(builtin_class(item.first), c);
+        }
+      }
 
-  }
+      // 否定クラスなら反転
+      return found != node.flag;
+    }
+
+    // 1文字にマッチするノード（文字、.、文字クラス）か
+    constexpr auto is_single_char_node(const syntax_node& node) -> bool {
+      return node.kind == node_kind::character or node.kind == node_kind::any or node.kind == node_kind::char_class;
+    }
+
+    // 分岐もキャプチャも無く、どの位置からでも高々1通りにしかマッチしないノードのマッチの長さ
+    // そうでなければnpos
+    template<typename Tree>
+    constexpr auto fixed_match_length(const Tree& tree, std::size_t index) -> std::size_t {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+      {
+        std::size_t length = 0;
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto n = fixed_match_length(tree, c);
+          if (n == syntax_node::npos) return syntax_node::npos;
+          length += n;
+        }
+        return length;
+      }
+      case node_kind::character: [[fallthrough]];
+      case node_kind::any: [[fallthrough]];
+      case node_kind::char_class:
+        return 1;
+      case node_kind::line_begin: [[fallthrough]];
+      case node_kind::line_end: [[fallthrough]];
+      case node_kind::word_boundary: [[fallthrough]];
+      case node_kind::not_word_boundary:
+        return 0;
+      case node_kind::group:
+        return fixed_match_length(tree, node.child);
+      case node_kind::repeat:
+      {
+        if (node.first != node.last) return syntax_node::npos;
+        const auto n = fixed_match_length(tree, node.child);
+        if (n == syntax_node::npos or (n != 0 and (syntax_node::npos - 1) / n < node.first)) return syntax_node::npos;
+        return n * node.first;
+      }
+      default:
+        // 選言、キャプチャ、後方参照、先読み
+        return syntax_node::npos;
+      }
+    }
+
+    // 1文字にマッチするノードが文字cを受理するか
+    template<typename Tree>
+    constexpr auto node_accepts(const Tree& tree, const syntax_node& node, std::size_t c) -> bool {
+      switch (node.kind) {
+      case node_kind::character:
+        return node.first == c;
+      case node_kind::any:
+        return not is_line_terminator_code(c);
+      case node_kind::char_class:
+        return class_contains(tree, node, c);
+      default:
+        return false;
+      }
+    }
+
+    // std::regexが実行時にエラーとする文字クラス名を含むか
+    template<typename Tree>
+    constexpr auto has_unknown_class(const Tree& tree) -> bool {
+      for (std::size_t i = 0; i < tree.class_item_count; ++i) {
+        const auto& item = tree.class_items[i];
+        if (item.kind == class_item_kind::builtin and builtin_class(item.first) == builtin_class::unknown) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // 状態を持たないエンジンは値で、それ以外は左辺値ならポインタで保持する
+    // 一時オブジェクト（regex<Pattern>()の戻り値など）はムーブして共有所有し、コピーしたイテレータからも参照できるようにする
+    template<typename E>
+    class engine_holder {
+      std::shared_ptr<const E> m_owned{};
+      const E* m_ptr = nullptr;
+    public:
+      engine_holder() = default;
+
+      constexpr engine_holder(const E& e) : m_ptr(std::addressof(e)) {}
+
+      engine_holder(E&& e)
+        : m_owned(std::make_shared<const E>(std::move(e)))
+        , m_ptr(m_owned.get())
+      {}
+
+      engine_holder(const E&& e)
+        : m_owned(std::make_shared<const E>(e))
+        , m_ptr(m_owned.get())
+      {}
+
+      constexpr auto get() const -> const E& {
+        return *m_ptr;
+      }
+    };
+
+    template<typename E>
+      requires std::is_empty_v<E> and std::default_initializable<E>
+    class engine_holder<E> {
+    public:
+      engine_holder() = default;
+
+      constexpr engine_holder(const E&) {}
+
+      constexpr auto get() const -> E {
+        return E{};
+      }
+    };
+
+    // エンジンの作業領域の型、持たないエンジンでは空
+    struct no_scratch {};
+
+    template<typename E>
+    struct scratch_of {
+      using type = no_scratch;
+    };
+
+    template<scratch_regex_searcher E>
+    struct scratch_of<E> {
+      using type = typename E::scratch_type;
+    };
+  }
+
+  // 256ビットで表す1バイト文字の集合
+  struct char_bitmap {
+    std::array<std::uint64_t, 4> words{};
+
+    constexpr void set(std::size_t c) {
+      words[c >> 6] |= std::uint64_t(1) << (c & 63);
+    }
+
+    constexpr auto test(std::size_t c) const -> bool {
+      return c < 256 and ((words[c >> 6] >> (c & 63)) & 1) != 0;
+    }
+
+    constexpr auto operator|=(const char_bitmap& other) -> char_bitmap& {
+      for (std::size_t i = 0; i < words.size(); ++i) {
+        words[i] |= other.words[i];
+      }
+      return *this;
+    }
+
+    friend constexpr auto operator==(const char_bitmap&, const char_bitmap&) -> bool = default;
+  };
+
+  namespace detail {
+
+    // 1文字にマッチするノードが受理するバイトの集合
+    template<typename Tree>
+    constexpr auto node_bitmap(const Tree& tree, const syntax_node& node) -> char_bitmap {
+      char_bitmap bitmap{};
+
+      for (std::size_t c = 0; c < 256; ++c) {
+        if (node_accepts(tree, node, c)) {
+          bitmap.set(c);
+        }
+      }
+
+      return bitmap;
+    }
+
+    // 1バイト文字の集合をSIMDで判定するための表
+    // lowとhighは下位4ビットで引き、上位4ビットが0～7、8～15の文字の所属をビットで持つ
+    struct byte_classifier {
+      char_bitmap bitmap{};
+      std::array<unsigned char, 16> low{};
+      std::array<unsigned char, 16> high{};
+
+      byte_classifier() = default;
+
+      constexpr byte_classifier(const char_bitmap& set)
+        : bitmap(set)
+      {
+        for (std::size_t c = 0; c < 256; ++c) {
+          if (not set.test(c)) continue;
+
+          auto& row = (c < 128) ? low[c & 0x0F] : high[c & 0x0F];
+          row |= static_cast<unsigned char>(1u << ((c >> 4) & 7));
+        }
+      }
+    };
+
+    inline namespace RIME_SIMD_NAMESPACE {
+
+#if defined(RIME_SIMD_SSSE3)
+      // 16バイトの各バイトが集合に含まれるかをビットマスクで返す
+      inline auto classify_16(__m128i x, const byte_classifier& cls) -> std::uint32_t {
+        const auto nibble = _mm_set1_epi8(0x0F);
+        const auto low = _mm_and_si128(x, nibble);
+        const auto high = _mm_and_si128(_mm_srli_epi16(x, 4), nibble);
+
+        const auto row_low = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cls.low.data())), low);
+        const auto row_high = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cls.high.data())), low);
+        const auto use_high = _mm_cmpgt_epi8(high, _mm_set1_epi8(7));
+        const auto row = _mm_or_si128(_mm_and_si128(use_high, row_high), _mm_andnot_si128(use_high, row_low));
+
+        const auto bit = _mm_shuffle_epi8(_mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128), high);
+        return std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), bit)));
+      }
+#endif
+
+#if defined(RIME_SIMD_AVX2)
+      // 32バイトの各バイトが集合に含まれるかをビットマスクで返す
+      inline auto classify_32(__m256i x, const byte_classifier& cls) -> std::uint32_t {
+        const auto nibble = _mm256_set1_epi8(0x0F);
+        const auto low = _mm256_and_si256(x, nibble);
+        const auto high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nibble);
+
+        const auto row_low = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cls.low.data()))), low);
+        const auto row_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(cls.high.data()))), low);
+        const auto row = _mm256_blendv_epi8(row_low, row_high, _mm256_cmpgt_epi8(high, _mm256_set1_epi8(7)));
+
+        const auto bit = _mm256_shuffle_epi8(_mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+                                                              1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128), high);
+        return std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), bit)));
+      }
+#endif
+
+      // [first, last)から集合に含まれる（Memberがfalseなら含まれない）最初の文字を探す
+      // 定数式では1文字ずつ判定する
+      template<bool Member>
+      constexpr auto find_in_class(const byte_classifier& cls, const char* first, const char* const last) -> const char* {
+        if (not std::is_constant_evaluated()) {
+#if defined(RIME_SIMD_AVX2)
+          for (; 32 <= last - first; first += 32) {
+            auto mask = classify_32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), cls);
+            if constexpr (not Member) mask = ~mask;
+            if (mask != 0) return first + std::countr_zero(mask);
+          }
+#endif
+#if defined(RIME_SIMD_SSSE3)
+          for (; 16 <= last - first; first += 16) {
+            auto mask = classify_16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), cls);
+            if constexpr (not Member) mask = ~mask & 0xFFFF;
+            if (mask != 0) return first + std::countr_zero(mask);
+          }
+#endif
+        }
+
+        for (; first != last; ++first) {
+          if (cls.bitmap.test(to_code(*first)) == Member) break;
+        }
+        return first;
+      }
+    }
+
+    // マッチの開始位置の候補を絞り込むための情報
+    struct start_filter {
+      // ^で始まり、入力の先頭でしかマッチしない
+      bool anchored = false;
+      // マッチは必ずfirstに含まれる文字から始まる（1バイト文字のみ）
+      bool has_first = false;
+      byte_classifier first{};
+
+      // pos以降で最初の開始位置の候補、無ければnpos
+      template<typename CharT>
+      constexpr auto next(std::basic_string_view<CharT> input, std::size_t pos) const -> std::size_t {
+        if (input.size() < pos or (anchored and pos != 0)) return syntax_node::npos;
+
+        if constexpr (std::same_as<CharT, char>) {
+          if (has_first) {
+            const auto* const last = input.data() + input.size();
+            const auto* p = find_in_class<true>(first, input.data() + pos, last);
+            return (p == last) ? syntax_node::npos : std::size_t(p - input.data());
+          }
+        }
+
+        return pos;
+      }
+    };
+
+    template<typename Tree>
+    constexpr auto make_start_filter(const Tree& tree) -> start_filter;
+  }
+
+  // 入力文字列を参照するマッチ結果、キャプチャグループを含めてN個の部分マッチを持つ
+  template<regex_usable_character CharT, std::size_t N>
+  class match_result {
+  public:
+    using char_type = CharT;
+    using view_type = std::basic_string_view<CharT>;
+    // 部分マッチの入力先頭からの位置[first, last)、マッチしていなければnpos
+    using groups_type = std::array<std::pair<std::size_t, std::size_t>, N>;
+
+    static constexpr std::size_t npos = syntax_node::npos;
+
+  private:
+    view_type m_input{};
+    groups_type m_groups = unmatched_groups();
+
+  public:
+    static constexpr auto unmatched_groups() -> groups_type {
+      groups_type groups{};
+      groups.fill({npos, npos});
+      return groups;
+    }
+
+    match_result() = default;
+
+    constexpr match_result(view_type input, const groups_type& groups)
+      : m_input(input)
+      , m_groups(groups)
+    {}
+
+    constexpr explicit operator bool() const noexcept {
+      return m_groups[0].first != npos;
+    }
+
+    static constexpr auto size() noexcept -> std::size_t {
+      return N;
+    }
+
+    constexpr auto matched(std::size_t i = 0) const -> bool {
+      return m_groups[i].first != npos;
+    }
+
+    constexpr auto position(std::size_t i = 0) const -> std::size_t {
+      return m_groups[i].first;
+    }
+
+    constexpr auto length(std::size_t i = 0) const -> std::size_t {
+      return matched(i) ? m_groups[i].second - m_groups[i].first : 0;
+    }
+
+    // マッチしていない部分マッチは空文字列
+    constexpr auto str(std::size_t i = 0) const -> view_type {
+      return matched(i) ? m_input.substr(m_groups[i].first, length(i)) : view_type{};
+    }
+
+    constexpr auto operator[](std::size_t i) const -> view_type {
+      return str(i);
+    }
+
+    constexpr auto prefix() const -> view_type {
+      return m_input.substr(0, matched() ? position() : m_input.size());
+    }
+
+    constexpr auto suffix() const -> view_type {
+      return matched() ? m_input.substr(m_groups[0].second) : view_type{};
+    }
+
+    // 部分マッチの終端の位置、マッチしていなければnpos
+    constexpr auto end_position(std::size_t i = 0) const -> std::size_t {
+      return m_groups[i].second;
+    }
+
+    // 照合した入力文字列全体
+    constexpr auto input() const -> view_type {
+      return m_input;
+    }
+
+    // キャプチャグループの文字列、auto [a, b] = m.groups(); のように受け取る
+    constexpr auto groups() const -> std::array<view_type, N - 1> {
+      std::array<view_type, N - 1> result{};
+      for (std::size_t i = 1; i < N; ++i) {
+        result[i - 1] = str(i);
+      }
+      return result;
+    }
+
+    // 構造化束縛ではマッチ全体とキャプチャグループの文字列になる
+    template<std::size_t I>
+      requires (I < N)
+    friend constexpr auto get(const match_result& m) -> view_type {
+      return m.str(I);
+    }
+  };
+
+  // std::sub_matchを入力文字列を参照するstring_viewにする
+  template<std::contiguous_iterator I>
+  [[nodiscard]]
+  constexpr auto to_string_view(const std::sub_match<I>& sm) -> std::basic_string_view<std::iter_value_t<I>> {
+    if (not sm.matched) return {};
+    return {std::to_address(sm.first), std::size_t(sm.second - sm.first)};
+  }
+
+  // std::match_resultsのキャプチャグループ1..Countをstring_viewで取り出す
+  template<std::size_t Count, std::contiguous_iterator I, typename Alloc>
+  [[nodiscard]]
+  auto captures(const std::match_results<I, Alloc>& m) -> std::array<std::basic_string_view<std::iter_value_t<I>>, Count> {
+    std::array<std::basic_string_view<std::iter_value_t<I>>, Count> result{};
+    for (std::size_t i = 1; i <= Count and i < m.size(); ++i) {
+      result[i - 1] = to_string_view(m[i]);
+    }
+    return result;
+  }
+}
+
+template<typename CharT, std::size_t N>
+struct std::tuple_size<rime::match_result<CharT, N>> : std::integral_constant<std::size_t, N> {};
+
+template<std::size_t I, typename CharT, std::size_t N>
+struct std::tuple_element<I, rime::match_result<CharT, N>> {
+  using type = std::basic_string_view<CharT>;
+};
+
+namespace rime::detail {
+
+  // regex_split_viewが区切りの検索に使う、エンジンごとのマッチの保持と部分マッチの取り出し
+  template<typename E>
+  struct split_engine {
+    using char_type = typename E::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = typename E::match_type;
+
+    [[no_unique_address]] engine_holder<E> engine{};
+
+    constexpr auto search(view_type input, std::size_t from, match_type& m) const -> bool {
+      m = engine.get().search(input, from);
+      return bool(m);
+    }
+
+    static constexpr auto group_count(const match_type&) -> std::size_t {
+      return match_type::size();
+    }
+
+    // 部分マッチの[first, last)、マッチしていなければnpos
+    static constexpr auto group(const match_type& m, view_type, std::size_t i) -> std::pair<std::size_t, std::size_t> {
+      return {m.position(i), m.end_position(i)};
+    }
+  };
+
+  template<typename CharT, typename Traits>
+  struct split_engine<std::basic_regex<CharT, Traits>> {
+    using char_type = CharT;
+    using view_type = std::basic_string_view<CharT>;
+    using match_type = std::match_results<const CharT*>;
+
+    const std::basic_regex<CharT, Traits>* engine = nullptr;
+
+    auto search(view_type input, std::size_t from, match_type& m) const -> bool {
+      const auto flags = (0 < from) ? std::regex_constants::match_prev_avail : std::regex_constants::match_default;
+      return std::regex_search(input.data() + from, input.data() + input.size(), m, *engine, flags);
+    }
+
+    static auto group_count(const match_type& m) -> std::size_t {
+      return m.size();
+    }
+
+    static auto group(const match_type& m, view_type input, std::size_t i) -> std::pair<std::size_t, std::size_t> {
+      if (not m[i].matched) return {syntax_node::npos, syntax_node::npos};
+      return {std::size_t(m[i].first - input.data()), std::size_t(m[i].second - input.data())};
+    }
+  };
+}
+
+namespace rime::ranges {
+
+  // regex_searcherによる連続的な検索結果を表すview
+  template<regex_searcher E>
+  class regex_search_view : public std::ranges::view_interface<regex_search_view<E>> {
+    using char_type = typename E::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = typename E::match_type;
+
+    [[no_unique_address]] detail::engine_holder<E> m_engine{};
+    view_type m_input{};
+
+    class iterator {
+      [[no_unique_address]] detail::engine_holder<E> m_engine{};
+      view_type m_input{};
+      match_type m_match{};
+
+    public:
+      using iterator_concept = std::forward_iterator_tag;
+      using value_type = match_type;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+
+      constexpr iterator(detail::engine_holder<E> engine, view_type input)
+        : m_engine(engine)
+        , m_input(input)
+        , m_match(m_engine.get().search(m_input, 0))
+      {}
+
+      constexpr auto operator*() const -> const match_type& {
+        return m_match;
+      }
+
+      constexpr auto operator->() const -> const match_type* {
+        return std::addressof(m_match);
+      }
+
+      constexpr auto operator++() -> iterator& {
+        // 空のマッチの後は1文字進めて検索する（ECMAScriptのString.prototype.matchAllと同じ）
+        // std::regex_iteratorは同じ位置から空でないマッチを探し直すので、a*?のようなパターンではマッチの列が異なる
+        auto next = m_match.position() + m_match.length();
+        if (m_match.length() == 0) ++next;
+
+        m_match = (next <= m_input.size()) ? m_engine.get().search(m_input, next) : match_type{};
+        return *this;
+      }
+
+      constexpr auto operator++(int) -> iterator {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+
+      friend constexpr auto operator==(const iterator& lhs, const iterator& rhs) -> bool {
+        if (not lhs.m_match or not rhs.m_match) {
+          return bool(lhs.m_match) == bool(rhs.m_match);
+        }
+        return lhs.m_match.position() == rhs.m_match.position() and lhs.m_match.length() == rhs.m_match.length();
+      }
+
+      friend constexpr auto operator==(const iterator& it, std::default_sentinel_t) -> bool {
+        return not it.m_match;
+      }
+    };
+
+  public:
+    regex_search_view() = default;
+
+    constexpr regex_search_view(view_type input, detail::engine_holder<E> engine)
+      : m_engine(std::move(engine))
+      , m_input(input)
+    {}
+
+    constexpr auto begin() const -> iterator {
+      return iterator{m_engine, m_input};
+    }
+
+    constexpr auto end() const -> std::default_sentinel_t {
+      return std::default_sentinel;
+    }
+  };
+
+  // 1つのマッチ結果とエンジンの作業領域を使い回して進むinput_range
+  // イテレータはviewを指すだけでコピーされず、2回目以降の検索で結果の領域を確保し直さない
+  // begin()は1度だけ呼び出せる
+  template<typename E>
+  class regex_scan_view;
+
+  template<regex_searcher E>
+  class regex_scan_view<E> : public std::ranges::view_interface<regex_scan_view<E>> {
+    using char_type = typename E::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = typename E::match_type;
+
+    [[no_unique_address]] detail::engine_holder<E> m_engine{};
+    view_type m_input{};
+    match_type m_match{};
+    [[no_unique_address]] typename detail::scratch_of<E>::type m_scratch{};
+
+    constexpr auto search(std::size_t from) -> match_type {
+      if constexpr (scratch_regex_searcher<E>) {
+        return m_engine.get().search(m_input, from, m_scratch);
+      } else {
+        return m_engine.get().search(m_input, from);
+      }
+    }
+
+    constexpr void advance() {
+      // 空のマッチの後は1文字進めて検索する、regex_searchesと同じ
+      auto next = m_match.position() + m_match.length();
+      if (m_match.length() == 0) ++next;
+
+      m_match = (next <= m_input.size()) ? search(next) : match_type{};
+    }
+
+    class iterator {
+      regex_scan_view* m_parent = nullptr;
+
+      constexpr auto done() const -> bool {
+        return not m_parent->m_match;
+      }
+
+    public:
+      using iterator_concept = std::input_iterator_tag;
+      using value_type = match_type;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+
+      constexpr explicit iterator(regex_scan_view* parent)
+        : m_parent(parent)
+      {}
+
+      iterator(iterator&&) = default;
+      auto operator=(iterator&&) -> iterator& = default;
+
+      constexpr auto operator*() const -> const match_type& {
+        return m_parent->m_match;
+      }
+
+      constexpr auto operator->() const -> const match_type* {
+        return std::addressof(m_parent->m_match);
+      }
+
+      constexpr auto operator++() -> iterator& {
+        m_parent->advance();
+        return *this;
+      }
+
+      constexpr void operator++(int) {
+        ++*this;
+      }
+
+      friend constexpr auto operator==(const iterator& it, std::default_sentinel_t) -> bool {
+        return it.done();
+      }
+    };
+
+  public:
+    regex_scan_view() = default;
+
+    constexpr regex_scan_view(view_type input, detail::engine_holder<E> engine)
+      : m_engine(std::move(engine))
+      , m_input(input)
+    {}
+
+    // エンジンの作業領域をresourceから確保する
+    regex_scan_view(view_type input, detail::engine_holder<E> engine, std::pmr::memory_resource* resource)
+      requires std::constructible_from<typename detail::scratch_of<E>::type, std::pmr::memory_resource*>
+      : m_engine(std::move(engine))
+      , m_input(input)
+      , m_scratch(resource)
+    {}
+
+    regex_scan_view(regex_scan_view&&) = default;
+    auto operator=(regex_scan_view&&) -> regex_scan_view& = default;
+
+    constexpr auto begin() -> iterator {
+      m_match = search(0);
+      return iterator{this};
+    }
+
+    constexpr auto end() const -> std::default_sentinel_t {
+      return std::default_sentinel;
+    }
+  };
+
+  // std::regex版、std::regex_iteratorをview内で進め、そのstd::match_resultsを使い回す
+  // マッチの列とposition()はstd::regex_iteratorと同じ（入力の先頭からの位置）
+  template<typename CharT, typename Traits>
+  class regex_scan_view<std::basic_regex<CharT, Traits>> : public std::ranges::view_interface<regex_scan_view<std::basic_regex<CharT, Traits>>> {
+    using view_type = std::basic_string_view<CharT>;
+    using regex_iterator = std::regex_iterator<const CharT*, CharT, Traits>;
+    using match_type = std::match_results<const CharT*>;
+
+    const std::basic_regex<CharT, Traits>* m_regex = nullptr;
+    view_type m_input{};
+    std::regex_constants::match_flag_type m_flags = std::regex_constants::match_default;
+    regex_iterator m_it{};
+
+    class iterator {
+      regex_scan_view* m_parent = nullptr;
+
+      auto done() const -> bool {
+        return m_parent->m_it == regex_iterator{};
+      }
+
+    public:
+      using iterator_concept = std::input_iterator_tag;
+      using value_type = match_type;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+
+      explicit iterator(regex_scan_view* parent)
+        : m_parent(parent)
+      {}
+
+      iterator(iterator&&) = default;
+      auto operator=(iterator&&) -> iterator& = default;
+
+      auto operator*() const -> const match_type& {
+        return *m_parent->m_it;
+      }
+
+      auto operator->() const -> const match_type* {
+        return std::addressof(*m_parent->m_it);
+      }
+
+      auto operator++() -> iterator& {
+        ++m_parent->m_it;
+        return *this;
+      }
+
+      void operator++(int) {
+        ++*this;
+      }
+
+      friend auto operator==(const iterator& it, std::default_sentinel_t) -> bool {
+        return it.done();
+      }
+    };
+
+  public:
+    regex_scan_view() = default;
+
+    regex_scan_view(view_type input, const std::basic_regex<CharT, Traits>& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default)
+      : m_regex(std::addressof(re))
+      , m_input(input)
+      , m_flags(flags)
+    {}
+
+    regex_scan_view(regex_scan_view&&) = default;
+    auto operator=(regex_scan_view&&) -> regex_scan_view& = default;
+
+    auto begin() -> iterator {
+      m_it = regex_iterator{m_input.data(), m_input.data() + m_input.size(), *m_regex, m_flags};
+      return iterator{this};
+    }
+
+    auto end() const -> std::default_sentinel_t {
+      return std::default_sentinel;
+    }
+  };
+
+  // 区切りの正規表現で入力文字列を分割し、区切りの間のフィールドをstring_viewで返すview
+  // groupsで選んだ区切りのキャプチャグループは、直前のフィールドの後に番号順に続く
+  // イテレータはviewを参照しないのでborrowed_range
+  template<typename E>
+  class regex_split_view : public std::ranges::view_interface<regex_split_view<E>> {
+    using engine_type = detail::split_engine<E>;
+    using char_type = typename engine_type::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = typename engine_type::match_type;
+
+    static constexpr std::size_t npos = syntax_node::npos;
+
+    engine_type m_engine{};
+    view_type m_input{};
+    // i番目のビットがキャプチャグループiを表す
+    std::uint64_t m_groups = 0;
+
+    class iterator {
+      engine_type m_engine{};
+      view_type m_input{};
+      std::uint64_t m_groups = 0;
+      match_type m_match{};
+      bool m_matched = false;
+      // 現在のフィールドの開始位置
+      std::size_t m_start = 0;
+      // 0ならフィールド、それ以外は返しているキャプチャグループ
+      std::size_t m_group = 0;
+      view_type m_value{};
+      bool m_end = true;
+
+      // m_startから始まるフィールドの終わりになる区切りを探す
+      // 空の区切りはフィールドの先頭と入力の末尾では使わない
+      constexpr void find_delimiter() {
+        m_matched = false;
+
+        for (auto pos = m_start; pos < m_input.size(); ) {
+          if (not m_engine.search(m_input, pos, m_match)) return;
+
+          const auto [first, last] = engine_type::group(m_match, m_input, 0);
+          if (m_input.size() <= first) return;
+
+          if (last == m_start) {
+            pos = first + 1;
+            continue;
+          }
+
+          m_matched = true;
+          return;
+        }
+      }
+
+      constexpr void set_field() {
+        m_group = 0;
+        find_delimiter();
+        const auto last = m_matched ? engine_type::group(m_match, m_input, 0).first : m_input.size();
+        m_value = m_input.substr(m_start, last - m_start);
+      }
+
+      // afterより後で、選ばれていてマッチに存在するキャプチャグループ
+      constexpr auto next_group(std::size_t after) const -> std::size_t {
+        if (63 <= after) return 0;
+        const auto rest = m_groups & ~((std::uint64_t(2) << after) - 1);
+        if (rest == 0) return 0;
+
+        const auto g = std::size_t(std::countr_zero(rest));
+        return g < engine_type::group_count(m_match) ? g : 0;
+      }
+
+    public:
+      using iterator_concept = std::forward_iterator_tag;
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = view_type;
+      using difference_type = std::ptrdiff_t;
+      using reference = view_type;
+
+      iterator() = default;
+
+      constexpr iterator(const engine_type& engine, view_type input, std::uint64_t groups)
+        : m_engine(engine)
+        , m_input(input)
+        , m_groups(groups)
+        , m_end(false)
+      {
+        set_field();
+      }
+
+      constexpr auto operator*() const -> view_type {
+        return m_value;
+      }
+
+      constexpr auto operator++() -> iterator& {
+        if (m_group == 0 and not m_matched) {
+          // 最後のフィールド
+          m_end = true;
+          return *this;
+        }
+
+        if (const auto g = next_group(m_group); g != 0) {
+          // 参加していないグループは空
+          const auto [first, last] = engine_type::group(m_match, m_input, g);
+          m_group = g;
+          m_value = (first == npos) ? view_type{} : m_input.substr(first, last - first);
+          return *this;
+        }
+
+        m_start = engine_type::group(m_match, m_input, 0).second;
+        set_field();
+        return *this;
+      }
+
+      constexpr auto operator++(int) -> iterator {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+
+      friend constexpr auto operator==(const iterator& lhs, const iterator& rhs) -> bool {
+        if (lhs.m_end or rhs.m_end) return lhs.m_end == rhs.m_end;
+        return lhs.m_start == rhs.m_start and lhs.m_group == rhs.m_group;
+      }
+
+      friend constexpr auto operator==(const iterator& it, std::default_sentinel_t) -> bool {
+        return it.m_end;
+      }
+    };
+
+  public:
+    regex_split_view() = default;
+
+    constexpr regex_split_view(view_type input, const engine_type& engine, std::uint64_t groups)
+      : m_engine(engine)
+      , m_input(input)
+      , m_groups(groups)
+    {}
+
+    constexpr auto begin() const -> iterator {
+      return iterator{m_engine, m_input, m_groups};
+    }
+
+    constexpr auto end() const -> std::default_sentinel_t {
+      return std::default_sentinel;
+    }
+  };
+}
+
+template<typename E>
+inline constexpr bool std::ranges::enable_borrowed_range<rime::ranges::regex_split_view<E>> = true;
+
+namespace rime {
+
+  // rime独自のエンジンで、入力文字列の中からパターンにマッチする部分を全て検索する
+  // 左辺値のエンジンは参照し、一時オブジェクトのエンジンはviewが所有する
+  template<typename Engine, regex_searcher E = std::remove_cvref_t<Engine>>
+  [[nodiscard]]
+  constexpr auto regex_searches(std::basic_string_view<typename E::char_type> input_str, Engine&& engine) -> ranges::regex_search_view<E> {
+    return ranges::regex_search_view<E>{input_str, std::forward<Engine>(engine)};
+  }
+
+  // regex_searchesと同じ検索を、マッチ結果と作業領域を使い回すinput_rangeで行う
+  template<typename Engine, regex_searcher E = std::remove_cvref_t<Engine>>
+  [[nodiscard]]
+  constexpr auto regex_scan(std::basic_string_view<typename E::char_type> input_str, Engine&& engine) -> ranges::regex_scan_view<E> {
+    return ranges::regex_scan_view<E>{input_str, std::forward<Engine>(engine)};
+  }
+
+  // エンジンの作業領域（pike_regexのスレッドリストなど）をresourceから確保する
+  template<typename Engine, regex_searcher E = std::remove_cvref_t<Engine>>
+    requires std::constructible_from<typename detail::scratch_of<E>::type, std::pmr::memory_resource*>
+  [[nodiscard]]
+  auto regex_scan(std::basic_string_view<typename E::char_type> input_str, Engine&& engine, std::pmr::memory_resource* resource) -> ranges::regex_scan_view<E> {
+    return ranges::regex_scan_view<E>{input_str, std::forward<Engine>(engine), resource};
+  }
+
+  template<regex_usable_character CharT, typename Traits>
+  [[nodiscard]]
+  auto regex_scan(std::basic_string_view<std::type_identity_t<CharT>> input_str, const std::basic_regex<CharT, Traits>& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) -> ranges::regex_scan_view<std::basic_regex<CharT, Traits>> {
+    return ranges::regex_scan_view<std::basic_regex<CharT, Traits>>{input_str, re, flags};
+  }
+
+  // 一時オブジェクトのstd::regexは参照が切れる
+  template<regex_usable_character CharT, typename Traits>
+  auto regex_scan(std::basic_string_view<std::type_identity_t<CharT>>, const std::basic_regex<CharT, Traits>&&, std::regex_constants::match_flag_type = std::regex_constants::match_default) = delete;
+
+  namespace detail {
+    // キャプチャグループの番号の並びをビット集合にする、1から63まで
+    // 範囲外の番号はstd::out_of_rangeを投げる（シフトの幅がビット数を超えないように）
+    constexpr auto split_group_mask(std::initializer_list<std::size_t> groups) -> std::uint64_t {
+      std::uint64_t mask = 0;
+      for (const auto g : groups) {
+        if (g == 0 or 64 <= g) {
+          throw std::out_of_range("rime::regex_split: capture group numbers must be between 1 and 63");
+        }
+        mask |= std::uint64_t(1) << g;
+      }
+      return mask;
+    }
+  }
+
+  // 区切りにマッチする部分で入力文字列を分割する、groupsで区切りのキャプチャグループも返す
+  // 一時オブジェクトのエンジンはイテレータが共有して所有するので、viewが先に破棄されても使える
+  template<typename Engine, regex_searcher E = std::remove_cvref_t<Engine>>
+  [[nodiscard]]
+  constexpr auto regex_split(std::basic_string_view<typename E::char_type> input_str, Engine&& engine, std::initializer_list<std::size_t> groups = {}) -> ranges::regex_split_view<E> {
+    return ranges::regex_split_view<E>{input_str, detail::split_engine<E>{std::forward<Engine>(engine)}, detail::split_group_mask(groups)};
+  }
+
+  template<regex_usable_character CharT, typename Traits>
+  [[nodiscard]]
+  auto regex_split(std::basic_string_view<std::type_identity_t<CharT>> input_str, const std::basic_regex<CharT, Traits>& re, std::initializer_list<std::size_t> groups = {}) -> ranges::regex_split_view<std::basic_regex<CharT, Traits>> {
+    return ranges::regex_split_view<std::basic_regex<CharT, Traits>>{input_str, detail::split_engine<std::basic_regex<CharT, Traits>>{std::addressof(re)}, detail::split_group_mask(groups)};
+  }
+
+  template<regex_usable_character CharT, typename Traits>
+  auto regex_split(std::basic_string_view<std::type_identity_t<CharT>>, const std::basic_regex<CharT, Traits>&&, std::initializer_list<std::size_t> = {}) = delete;
+
+  // パターンの構文木から展開されたマッチャによって、実行時のコンパイルなしに照合する
+  template<fixed_string Pattern>
+  class static_regex {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+
+    static constexpr auto tree = parse<Pattern>();
+
+    using match_type = match_result<char_type, tree.capture_group_count + 1>;
+
+  private:
+    using groups_type = typename match_type::groups_type;
+    static constexpr std::size_t npos = syntax_node::npos;
+
+    static_assert(not detail::has_unknown_class(tree), "Unknown character class name.");
+    static_assert(not detail::strict_backtracking or not detail::find_backtracking_hazard(tree), "The pattern can cause catastrophic backtracking.");
+
+    struct context {
+      view_type input;
+      groups_type groups;
+    };
+
+    // ノードIをposから照合し、成功したら照合後の位置で継続kを呼ぶ
+    template<std::size_t I>
+    fn eval(context& ctx, std::size_t pos, auto&& k) -> bool {
+      constexpr auto& node = tree.nodes[I];
+
+      if constexpr (node.kind == node_kind::concatenation) {
+        return eval_sequence<node.child>(ctx, pos, k);
+      } else if constexpr (node.kind == node_kind::alternation) {
+        return eval_alternatives<node.child>(ctx, pos, k);
+      } else if constexpr (detail::is_single_char_node(node)) {
+        if (pos < ctx.input.size() and accepts<I>(ctx.input[pos])) {
+          return k(pos + 1);
+        }
+        return false;
+      } else if constexpr (node.kind == node_kind::back_reference) {
+        return eval_back_reference<I>(ctx, pos, k);
+      } else if constexpr (node.kind == node_kind::line_begin) {
+        return pos == 0 and k(pos);
+      } else if constexpr (node.kind == node_kind::line_end) {
+        return pos == ctx.input.size() and k(pos);
+      } else if constexpr (node.kind == node_kind::word_boundary or node.kind == node_kind::not_word_boundary) {
+        const bool prev = 0 < pos and detail::is_word_code(to_code(ctx.input[pos - 1]));
+        const bool next = pos < ctx.input.size() and detail::is_word_code(to_code(ctx.input[pos]));
+        return ((prev != next) == (node.kind == node_kind::word_boundary)) and k(pos);
+      } else if constexpr (node.kind == node_kind::capture) {
+        const auto saved = ctx.groups[node.first];
+
+        if (eval<node.child>(ctx, pos, [&](std::size_t p) {
+          ctx.groups[node.first] = {pos, p};
+          return k(p);
+        })) {
+          return true;
+        }
+
+        ctx.groups[node.first] = saved;
+        return false;
+      } else if constexpr (node.kind == node_kind::group) {
+        return eval<node.child>(ctx, pos, k);
+      } else if constexpr (node.kind == node_kind::lookahead) {
+        const auto saved = ctx.groups;
+
+        // 先読みの中へはバックトラックしない
+        if (eval<node.child>(ctx, pos, [](std::size_t) { return true; }) and k(pos)) {
+          return true;
+        }
+
+        ctx.groups = saved;
+        return false;
+      } else if constexpr (node.kind == node_kind::negative_lookahead) {
+        const auto saved = ctx.groups;
+        const bool found = eval<node.child>(ctx, pos, [](std::size_t) { return true; });
+        ctx.groups = saved;
+
+        return not found and k(pos);
+      } else {
+        static_assert(node.kind == node_kind::repeat);
+        return eval_repeat<I>(ctx, pos, 0, k);
+      }
+    }
+
+    // 兄弟ノードを先頭から順に照合する
+    template<std::size_t I>
+    fn eval_sequence(context& ctx, std::size_t pos, auto&& k) -> bool {
+      if constexpr (I == npos) {
+        return k(pos);
+      } else {
+        return eval<I>(ctx, pos, [&](std::size_t p) {
+          return eval_sequence<tree.nodes[I].sibling>(ctx, p, k);
+        });
+      }
+    }
+
+    // 兄弟ノードを先頭から順に試す
+    template<std::size_t I>
+    fn eval_alternatives(context& ctx, std::size_t pos, auto&& k) -> bool {
+      if constexpr (I == npos) {
+        return false;
+      } else {
+        return eval<I>(ctx, pos, k) or eval_alternatives<tree.nodes[I].sibling>(ctx, pos, k);
+      }
+    }
+
+    template<std::size_t I>
+    fn eval_back_reference(context& ctx, std::size_t pos, auto&& k) -> bool {
+      const auto [first, last] = ctx.groups[tree.nodes[I].first];
+
+      // マッチしていないグループの参照は空文字列にマッチする
+      if (first == npos) {
+        return k(pos);
+      }
+
+      const auto len = last - first;
+      if (ctx.input.size() - pos < len or ctx.input.substr(first, len) != ctx.input.substr(pos, len)) {
+        return false;
+      }
+
+      return k(pos + len);
+    }
+
+    template<std::size_t I>
+    fn eval_repeat(context& ctx, std::size_t pos, std::size_t count, auto&& k) -> bool {
+      constexpr auto& node = tree.nodes[I];
+      constexpr auto min = node.first;
+      constexpr auto max = node.last;
+
+      if constexpr (detail::is_single_char_node(tree.nodes[node.child])) {
+        // 1文字の繰り返しは再帰せずに処理する
+        const auto limit = std::min(ctx.input.size() - pos, max);
+
+        if constexpr (node.flag) {
+          std::size_t n = 0;
+          if constexpr (std::same_as<char_type, char>) {
+            const auto* first = ctx.input.data() + pos;
+            n = std::size_t(detail::find_in_class<false>(classifier<node.child>, first, first + limit) - first);
+          } else {
+            while (n < limit and accepts<node.child>(ctx.input[pos + n])) ++n;
+          }
+
+          if (n < min) return false;
+
+          for (auto i = n; ; --i) {
+            if (k(pos + i)) return true;
+            if (i == min) return false;
+          }
+        } else {
+          for (std::size_t i = 0; ; ++i) {
+            if (min <= i and k(pos + i)) return true;
+            if (limit <= i or not accepts<node.child>(ctx.input[pos + i])) return false;
+          }
+        }
+      } else if constexpr (constexpr auto length = detail::fixed_match_length(tree, node.child); length != 0 and length != npos) {
+        // 本体のマッチが1通りに決まるなら、繰り返しごとに再帰せずに処理する
+        const auto once = [&](std::size_t i) {
+          return eval<node.child>(ctx, pos + i * length, [](std::size_t) { return true; });
+        };
+
+        if constexpr (node.flag) {
+          std::size_t n = 0;
+          while (n < max and once(n)) ++n;
+
+          if (n < min) return false;
+
+          for (auto i = n; ; --i) {
+            if (k(pos + i * length)) return true;
+            if (i == min) return false;
+          }
+        } else {
+          for (std::size_t i = 0; ; ++i) {
+            if (min <= i and k(pos + i * length)) return true;
+            if (i == max or not once(i)) return false;
+          }
+        }
+      } else {
+        if (count < min) {
+          return eval<node.child>(ctx, pos, [&](std::size_t p) {
+            return eval_repeat<I>(ctx, p, count + 1, k);
+          });
+        }
+        if (count == max) {
+          return k(pos);
+        }
+
+        const auto once_more = [&] {
+          return eval<node.child>(ctx, pos, [&](std::size_t p) {
+            // 最小回数以降の空の繰り返しは失敗とする
+            return p != pos and eval_repeat<I>(ctx, p, count + 1, k);
+          });
+        };
+
+        if constexpr (node.flag) {
+          return once_more() or k(pos);
+        } else {
+          return k(pos) or once_more();
+        }
+      }
+    }
+
+    template<std::size_t I>
+    fn accepts(char_type c) -> bool {
+      return detail::node_accepts(tree, tree.nodes[I], to_code(c));
+    }
+
+    // 1文字にマッチするノードIの受理する文字の表
+    template<std::size_t I>
+    static constexpr detail::byte_classifier classifier = detail::node_bitmap(tree, tree.nodes[I]);
+
+    // マッチの開始位置の候補
+    static constexpr auto starts = detail::make_start_filter(tree);
+
+    // startから始まるマッチを探す
+    fn match_at(view_type input, std::size_t start, auto&& accept) -> match_type {
+      context ctx{input, match_type::unmatched_groups()};
+      std::size_t last = 0;
+
+      if (eval<tree.root>(ctx, start, [&](std::size_t p) {
+        if (not accept(p)) return false;
+        last = p;
+        return true;
+      })) {
+        ctx.groups[0] = {start, last};
+        return {input, ctx.groups};
+      }
+
+      return {};
+    }
+
+  public:
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    static constexpr auto match(view_type input) -> match_type {
+      return match_at(input, 0, [size = input.size()](std::size_t p) { return p == size; });
+    }
+
+    // fromの位置以降で最初にマッチする部分を探す
+    [[nodiscard]]
+    static constexpr auto search(view_type input, std::size_t from = 0) -> match_type {
+      // 先頭の文字になり得ない位置は読み飛ばす
+      for (auto start = starts.next(input, from); start != npos; start = starts.next(input, start + 1)) {
+        if (auto m = match_at(input, start, [](std::size_t) { return true; })) {
+          return m;
+        }
+      }
+
+      return {};
+    }
+
+    [[nodiscard]]
+    static constexpr auto searches(view_type input) {
+      return rime::regex_searches(input, static_regex{});
+    }
+  };
+
+  namespace detail {
+
+    enum class nfa_op : unsigned char {
+      consume,      // setsのx番目の集合に含まれる1文字を消費、yは構文木のノード
+      split,        // xとyに分岐（xが優先）
+      jump,         // xへ移動
+      save,         // x番目のキャプチャ位置を記録
+      clear,        // x番目からy番目の手前までのキャプチャ位置を未設定に戻す
+      assert_begin, // 入力の先頭
+      assert_end,   // 入力の末尾
+      assert_word_boundary,     // \b
+      assert_not_word_boundary, // \B
+      match
+    };
+
+    struct nfa_inst {
+      nfa_op op{};
+      std::size_t x = 0;
+      std::size_t y = 0;
+    };
+
+    // 構文木から生成されるThompson NFA
+    struct nfa_program {
+      constexpr_vector<nfa_inst> insts;
+      constexpr_vector<char_bitmap> sets;
+    };
+
+    // NFAの命令数の上限
+    inline constexpr std::size_t nfa_size_limit = 1 << 14;
+
+    // ノード以下のキャプチャグループの番号の範囲[first, last)、グループの番号は連続している
+    template<typename Tree>
+    constexpr auto capture_range(const Tree& tree, std::size_t index) -> std::pair<std::size_t, std::size_t> {
+      const auto& node = tree.nodes[index];
+
+      std::size_t first = syntax_node::npos;
+      std::size_t last = 0;
+      if (node.kind == node_kind::capture) {
+        first = node.first;
+        last = node.first + 1;
+      }
+      for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+        const auto [f, l] = capture_range(tree, c);
+        first = std::min(first, f);
+        last = std::max(last, l);
+      }
+      return {first, last};
+    }
+
+    template<typename Tree>
+    class nfa_compiler {
+      const Tree& m_tree;
+      nfa_program& m_prog;
+
+      constexpr auto push(nfa_inst inst) -> std::size_t {
+        if (nfa_size_limit <= m_prog.insts.size()) {
+          REGEX_PATTERN_ERROR("The pattern is too large to build an automaton.");
+        }
+        m_prog.insts.push_back(inst);
+        return m_prog.insts.size() - 1;
+      }
+
+      constexpr auto set_index(const char_bitmap& set) -> std::size_t {
+        const auto n = char_to_num(m_prog.sets, set);
+        if (n == m_prog.sets.size()) {
+          m_prog.sets.push_back(set);
+        }
+        return n;
+      }
+
+      constexpr auto here() const -> std::size_t {
+        return m_prog.insts.size();
+      }
+
+    public:
+      constexpr nfa_compiler(const Tree& tree, nfa_program& prog)
+        : m_tree(tree)
+        , m_prog(prog)
+      {}
+
+      // ノードの命令列を末尾に追加する、命令列の後はその次の命令に続く
+      constexpr void emit(std::size_t index) {
+        const auto& node = m_tree.nodes[index];
+
+        switch (node.kind) {
+        case node_kind::concatenation:
+          for (auto c = node.child; c != syntax_node::npos; c = m_tree.nodes[c].sibling) {
+            emit(c);
+          }
+          return;
+        case node_kind::alternation:
+        {
+          constexpr_vector<std::size_t> jumps;
+
+          auto c = node.child;
+          for (; m_tree.nodes[c].sibling != syntax_node::npos; c = m_tree.nodes[c].sibling) {
+            const auto split = push({nfa_op::split});
+            m_prog.insts[split].x = here();
+            emit(c);
+            jumps.push_back(push({nfa_op::jump}));
+            m_prog.insts[split].y = here();
+          }
+          emit(c);
+
+          for (const auto j : jumps) {
+            m_prog.insts[j].x = here();
+          }
+          return;
+        }
+        case node_kind::character: [[fallthrough]];
+        case node_kind::any: [[fallthrough]];
+        case node_kind::char_class:
+          push({nfa_op::consume, set_index(node_bitmap(m_tree, node)), index});
+          return;
+        case node_kind::line_begin:
+          push({nfa_op::assert_begin});
+          return;
+        case node_kind::line_end:
+          push({nfa_op::assert_end});
+          return;
+        case node_kind::word_boundary:
+          push({nfa_op::assert_word_boundary});
+          return;
+        case node_kind::not_word_boundary:
+          push({nfa_op::assert_not_word_boundary});
+          return;
+        case node_kind::capture:
+          push({nfa_op::save, 2 * node.first});
+          emit(node.child);
+          push({nfa_op::save, 2 * node.first + 1});
+          return;
+        case node_kind::group:
+          emit(node.child);
+          return;
+        case node_kind::repeat:
+          emit_repeat(node);
+          return;
+        default:
+          // 後方参照、先読み
+          REGEX_PATTERN_ERROR("Back references and lookahead assertions cannot be converted to an automaton.");
+        }
+      }
+
+      // 繰り返しの本体の命令列、ECMAScriptと同じく繰り返しごとに本体の中のキャプチャを未設定に戻す
+      constexpr void emit_body(const syntax_node& node) {
+        if (const auto [first, last] = capture_range(m_tree, node.child); first < last) {
+          push({nfa_op::clear, 2 * first, 2 * last});
+        }
+        emit(node.child);
+      }
+
+      constexpr void emit_repeat(const syntax_node& node) {
+        for (std::size_t i = 0; i < node.first; ++i) {
+          emit_body(node);
+        }
+
+        // 分岐の優先順位、貪欲なら繰り返す方を優先
+        const auto branch = [&](std::size_t split, std::size_t body, std::size_t out) {
+          m_prog.insts[split].x = node.flag ? body : out;
+          m_prog.insts[split].y = node.flag ? out : body;
+        };
+
+        if (node.last == syntax_node::npos) {
+          const auto split = push({nfa_op::split});
+          emit_body(node);
+          push({nfa_op::jump, split});
+          branch(split, split + 1, here());
+          return;
+        }
+
+        constexpr_vector<std::size_t> splits;
+        for (auto i = node.first; i < node.last; ++i) {
+          splits.push_back(push({nfa_op::split}));
+          emit_body(node);
+        }
+        for (const auto split : splits) {
+          branch(split, split + 1, here());
+        }
+      }
+    };
+
+    template<typename Tree>
+    constexpr auto compile_nfa(const Tree& tree) -> nfa_program {
+      nfa_program prog{};
+      nfa_compiler<Tree> compiler{tree, prog};
+
+      compiler.emit(tree.root);
+      prog.insts.push_back({nfa_op::match});
+
+      return prog;
+    }
+
+    // pcからε遷移で到達できる、入力を待つ命令（consume, assert_end, match）を集める
+    // at_beginなら先頭のアサーションを、at_endなら末尾のアサーションを通過する
+    constexpr void nfa_closure(const nfa_program& prog, std::size_t pc, bool at_begin, bool at_end, constexpr_vector<std::size_t>& out, constexpr_vector<unsigned char>& visited) {
+      constexpr_vector<std::size_t> stack{pc};
+
+      while (not stack.empty()) {
+        const auto p = stack.back();
+        stack.pop_back();
+
+        if (visited[p]) continue;
+        visited[p] = true;
+
+        const auto& inst = prog.insts[p];
+        switch (inst.op) {
+        case nfa_op::split:
+          stack.push_back(inst.y);
+          stack.push_back(inst.x);
+          break;
+        case nfa_op::jump:
+          stack.push_back(inst.x);
+          break;
+        case nfa_op::save: [[fallthrough]];
+        case nfa_op::clear:
+          stack.push_back(p + 1);
+          break;
+        case nfa_op::assert_begin:
+          if (at_begin) stack.push_back(p + 1);
+          break;
+        case nfa_op::assert_end:
+          if (at_end) {
+            stack.push_back(p + 1);
+          } else {
+            out.push_back(p);
+          }
+          break;
+        default:
+          out.push_back(p);
+          break;
+        }
+      }
+    }
+
+    // 部分集合構成法とMooreのアルゴリズムで構築した最小DFA
+    struct dfa_data {
+      // バイトの同値類
+      std::array<std::size_t, 256> byte_class{};
+      std::size_t class_count = 0;
+      std::size_t state_count = 0;
+      // 状態0は空集合（死状態）、state * class_count + cls で引く
+      constexpr_vector<std::size_t> next;
+      constexpr_vector<unsigned char> accept;
+      constexpr_vector<unsigned char> accept_at_end;
+      std::size_t start = 0;
+      // 空の入力を受理するか
+      bool accepts_empty = false;
+    };
+
+    // DFAの状態数の上限
+    inline constexpr std::size_t dfa_state_limit = 1 << 12;
+
+    // unanchoredなら入力のどの位置からでもマッチを開始できるDFA（検索用）を作る
+    constexpr auto build_dfa(const nfa_program& prog, bool unanchored) -> dfa_data {
+      dfa_data dfa{};
+      const auto n = prog.insts.size();
+
+      if (std::ranges::any_of(prog.insts, [](const auto& inst) { return inst.op == nfa_op::assert_word_boundary or inst.op == nfa_op::assert_not_word_boundary; })) {
+        REGEX_PATTERN_ERROR("Word boundaries cannot be converted to a DFA.");
+      }
+
+      // どの集合にも同じように振り分けられるバイトを同値類にまとめる
+      for (const auto& set : prog.sets) {
+        constexpr_vector<std::size_t> renumber(2 * 256, syntax_node::npos);
+        std::size_t count = 0;
+
+        for (std::size_t c = 0; c < 256; ++c) {
+          auto& id = renumber[2 * dfa.byte_class[c] + (set.test(c) ? 1 : 0)];
+          if (id == syntax_node::npos) id = count++;
+          dfa.byte_class[c] = id;
+        }
+      }
+      dfa.class_count = *std::ranges::max_element(dfa.byte_class) + 1;
+
+      const auto closure_of = [&](const constexpr_vector<std::size_t>& pcs, bool at_begin, bool at_end) {
+        constexpr_vector<std::size_t> out;
+        constexpr_vector<unsigned char> visited(n, false);
+        for (const auto pc : pcs) {
+          nfa_closure(prog, pc, at_begin, at_end, out, visited);
+        }
+        std::ranges::sort(out);
+        return out;
+      };
+      const auto has_match = [&](const constexpr_vector<std::size_t>& set) {
+        return std::ranges::any_of(set, [&](auto pc) { return prog.insts[pc].op == nfa_op::match; });
+      };
+
+      const auto restart = closure_of({0}, false, false);
+
+      constexpr_vector<constexpr_vector<std::size_t>> states{{}};
+      const auto state_of = [&](constexpr_vector<std::size_t>&& set) {
+        const auto i = char_to_num(states, set);
+        if (i == states.size()) {
+          if (dfa_state_limit <= states.size()) {
+            REGEX_PATTERN_ERROR("The pattern is too large to build an automaton.");
+          }
+          states.push_back(std::move(set));
+        }
+        return i;
+      };
+
+      dfa.start = state_of(closure_of({0}, true, false));
+      {
+        const auto start_set = closure_of({0}, true, false);
+        constexpr_vector<std::size_t> ends;
+        for (const auto pc : start_set) {
+          if (prog.insts[pc].op == nfa_op::assert_end) ends.push_back(pc + 1);
+        }
+        dfa.accepts_empty = has_match(start_set) or has_match(closure_of(ends, true, true));
+      }
+
+      constexpr_vector<std::size_t> next;
+      for (std::size_t s = 0; s < states.size(); ++s) {
+        for (std::size_t cls = 0; cls < dfa.class_count; ++cls) {
+          const auto c = char_to_num(dfa.byte_class, cls);
+
+          constexpr_vector<std::size_t> targets;
+          for (const auto pc : states[s]) {
+            const auto& inst = prog.insts[pc];
+            if (inst.op == nfa_op::consume and prog.sets[inst.x].test(c)) {
+              targets.push_back(pc + 1);
+            }
+          }
+          if (unanchored) {
+            targets.insert(targets.end(), restart.begin(), restart.end());
+          }
+
+          next.push_back(state_of(closure_of(targets, false, false)));
+        }
+      }
+
+      // 受理の判定
+      constexpr_vector<std::size_t> group(states.size());
+      for (std::size_t s = 0; s < states.size(); ++s) {
+        constexpr_vector<std::size_t> ends;
+        for (const auto pc : states[s]) {
+          if (prog.insts[pc].op == nfa_op::assert_end) ends.push_back(pc + 1);
+        }
+
+        const bool accept = has_match(states[s]);
+        const bool accept_at_end = accept or has_match(closure_of(ends, false, true));
+
+        // 初期分割、死状態を0にする
+        group[s] = (s == 0) ? 0 : (accept ? 2 : 0) + (accept_at_end ? 1 : 0);
+        dfa.accept.push_back(accept);
+        dfa.accept_at_end.push_back(accept_at_end);
+      }
+
+      // Mooreのアルゴリズムによる最小化
+      for (std::size_t group_count = 0;;) {
+        constexpr_vector<constexpr_vector<std::size_t>> signatures;
+        constexpr_vector<std::size_t> new_group(states.size());
+
+        for (std::size_t s = 0; s < states.size(); ++s) {
+          constexpr_vector<std::size_t> sig{group[s]};
+          for (std::size_t cls = 0; cls < dfa.class_count; ++cls) {
+            sig.push_back(group[next[s * dfa.class_count + cls]]);
+          }
+
+          const auto i = char_to_num(signatures, sig);
+          if (i == signatures.size()) signatures.push_back(std::move(sig));
+          new_group[s] = i;
+        }
+
+        group = std::move(new_group);
+        if (signatures.size() == group_count) break;
+        group_count = signatures.size();
+      }
+
+      // 同じグループの状態を1つにまとめる（死状態は常に0になる）
+      dfa.state_count = *std::ranges::max_element(group) + 1;
+      dfa.next.assign(dfa.state_count * dfa.class_count, 0);
+      constexpr_vector<unsigned char> accept(dfa.state_count), accept_at_end(dfa.state_count);
+
+      for (std::size_t s = 0; s < states.size(); ++s) {
+        for (std::size_t cls = 0; cls < dfa.class_count; ++cls) {
+          dfa.next[group[s] * dfa.class_count + cls] = group[next[s * dfa.class_count + cls]];
+        }
+        accept[group[s]] = dfa.accept[s];
+        accept_at_end[group[s]] = dfa.accept_at_end[s];
+      }
+
+      dfa.accept = std::move(accept);
+      dfa.accept_at_end = std::move(accept_at_end);
+      dfa.start = group[dfa.start];
+
+      return dfa;
+    }
+
+    // 1バイトにつき1回の表引きで遷移するDFAの遷移表
+    template<std::size_t States>
+    struct dfa_table {
+      // 状態は遷移表の行の先頭位置（状態番号 * 256）で表す
+      std::array<std::uint32_t, States * 256> next{};
+      std::array<bool, States> accept{};
+      std::array<bool, States> accept_at_end{};
+      std::uint32_t start = 0;
+      bool accepts_empty = false;
+
+      constexpr dfa_table(const dfa_data& dfa) {
+        for (std::size_t s = 0; s < States; ++s) {
+          for (std::size_t c = 0; c < 256; ++c) {
+            next[s * 256 + c] = std::uint32_t(dfa.next[s * dfa.class_count + dfa.byte_class[c]] * 256);
+          }
+          accept[s] = dfa.accept[s];
+          accept_at_end[s] = dfa.accept_at_end[s];
+        }
+        start = std::uint32_t(dfa.start * 256);
+        accepts_empty = dfa.accepts_empty;
+      }
+    };
+  }
+
+  // 後方参照や先読みを含まないパターンから構築したDFAによって、入力長に線形な時間で照合する
+  template<fixed_string Pattern>
+  class static_dfa {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+
+    static_assert(std::same_as<char_type, char>, "static_dfa supports only char patterns.");
+
+    static constexpr auto tree = parse<Pattern>();
+
+  private:
+    static constexpr auto build(bool unanchored) -> detail::dfa_data {
+      return detail::build_dfa(detail::compile_nfa(tree), unanchored);
+    }
+
+  public:
+    // 入力全体の照合用
+    static constexpr detail::dfa_table<build(false).state_count> match_table = build(false);
+    // 部分文字列の検索用
+    static constexpr detail::dfa_table<build(true).state_count> search_table = build(true);
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    static constexpr auto match(view_type input) -> bool {
+      if (input.empty()) return match_table.accepts_empty;
+
+      auto s = match_table.start;
+      for (const auto c : input) {
+        s = match_table.next[s + to_code(c)];
+        if (s == 0) return false;
+      }
+
+      return match_table.accept_at_end[s / 256];
+    }
+
+    // 入力文字列のどこかにマッチする部分があるか
+    [[nodiscard]]
+    static constexpr auto search(view_type input) -> bool {
+      if (input.empty()) return search_table.accepts_empty;
+
+      auto s = search_table.start;
+      if (search_table.accept[s / 256]) return true;
+
+      for (const auto c : input) {
+        s = search_table.next[s + to_code(c)];
+        if (search_table.accept[s / 256]) return true;
+        if (s == 0) return false;
+      }
+
+      return search_table.accept_at_end[s / 256];
+    }
+  };
+
+  namespace detail {
+
+    // 先頭になり得る文字の集合
+    struct first_chars {
+      char_bitmap bytes{};
+      // 256以上の文字を含み得るか
+      bool wide = false;
+      // 空文字列にマッチし得るか
+      bool nullable = false;
+
+      constexpr void merge(const first_chars& other) {
+        bytes |= other.bytes;
+        wide = wide or other.wide;
+      }
+
+      constexpr auto overlaps(const first_chars& other) const -> bool {
+        for (std::size_t i = 0; i < bytes.words.size(); ++i) {
+          if ((bytes.words[i] & other.bytes.words[i]) != 0) return true;
+        }
+        return wide and other.wide;
+      }
+    };
+
+    // 1文字にマッチするノードが256以上の文字を受理し得るか
+    template<typename Tree>
+    constexpr auto accepts_wide_char(const Tree& tree, const syntax_node& node) -> bool {
+      switch (node.kind) {
+      case node_kind::character:
+        return 256 <= node.first;
+      case node_kind::char_class:
+        if (node.flag) return true;
+
+        for (auto i = node.first; i < node.last; ++i) {
+          const auto& item = tree.class_items[i];
+          if (item.kind == class_item_kind::range ? 256 <= item.last : builtin_class::not_digit <= builtin_class(item.first)) {
+            return true;
+          }
+        }
+        return false;
+      default:
+        return true;
+      }
+    }
+
+    template<typename Tree>
+    constexpr auto first_chars_of(const Tree& tree, std::size_t index) -> first_chars {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+      {
+        first_chars result{{}, false, true};
+        for (auto c = node.child; c != syntax_node::npos and result.nullable; c = tree.nodes[c].sibling) {
+          const auto f = first_chars_of(tree, c);
+          result.merge(f);
+          result.nullable = f.nullable;
+        }
+        return result;
+      }
+      case node_kind::alternation:
+      {
+        first_chars result{};
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto f = first_chars_of(tree, c);
+          result.merge(f);
+          result.nullable = result.nullable or f.nullable;
+        }
+        return result;
+      }
+      case node_kind::character: [[fallthrough]];
+      case node_kind::any: [[fallthrough]];
+      case node_kind::char_class:
+        return {node_bitmap(tree, node), accepts_wide_char(tree, node), false};
+      case node_kind::back_reference:
+      {
+        // 何にでもなり得る
+        first_chars result{{}, true, true};
+        result.bytes.words.fill(~std::uint64_t(0));
+        return result;
+      }
+      case node_kind::capture: [[fallthrough]];
+      case node_kind::group:
+        return first_chars_of(tree, node.child);
+      case node_kind::repeat:
+      {
+        auto result = first_chars_of(tree, node.child);
+        result.nullable = result.nullable or node.first == 0;
+        return result;
+      }
+      default:
+        // アサーション
+        return {{}, false, true};
+      }
+    }
+
+    // ノードのマッチの末尾で終わり得る、回数が一定でない繰り返しを集める
+    template<typename Tree>
+    constexpr void trailing_repeats(const Tree& tree, std::size_t index, constexpr_vector<std::size_t>& out) {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+      {
+        constexpr_vector<std::size_t> children;
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          children.push_back(c);
+        }
+        for (auto it = children.rbegin(); it != children.rend(); ++it) {
+          trailing_repeats(tree, *it, out);
+          if (not first_chars_of(tree, *it).nullable) break;
+        }
+        return;
+      }
+      case node_kind::alternation:
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          trailing_repeats(tree, c, out);
+        }
+        return;
+      case node_kind::capture: [[fallthrough]];
+      case node_kind::group:
+        trailing_repeats(tree, node.child, out);
+        return;
+      case node_kind::repeat:
+        if (node.first != node.last) out.push_back(index);
+        trailing_repeats(tree, node.child, out);
+        return;
+      default:
+        return;
+      }
+    }
+
+    // ノード以下の連接で、回数が一定でない繰り返しの後に続く部分が、その繰り返しの本体と同じ文字から始まり得るか
+    template<typename Tree>
+    constexpr auto has_overlapping_sequence(const Tree& tree, std::size_t index) -> bool {
+      const auto& node = tree.nodes[index];
+
+      if (node.kind == node_kind::concatenation) {
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          // cの後に続く部分の先頭の文字
+          first_chars rest{{}, false, true};
+          for (auto d = tree.nodes[c].sibling; d != syntax_node::npos and rest.nullable; d = tree.nodes[d].sibling) {
+            const auto f = first_chars_of(tree, d);
+            rest.merge(f);
+            rest.nullable = f.nullable;
+          }
+
+          constexpr_vector<std::size_t> repeats;
+          trailing_repeats(tree, c, repeats);
+          for (const auto r : repeats) {
+            if (first_chars_of(tree, tree.nodes[r].child).overlaps(rest)) return true;
+          }
+        }
+      }
+
+      for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+        if (has_overlapping_sequence(tree, c)) return true;
+      }
+      return false;
+    }
+
+    // 上限がこの回数以上の繰り返しは、上限の無い繰り返しと同じく判定する
+    // (a+){1,30}のような繰り返しも、入力の長さの30乗の時間がかかり得る
+    inline constexpr std::size_t hazard_repeat_count = 4;
+
+    // 上限の無い（または大きい）繰り返しについて、同じ入力を複数の方法で消費できる構造を探す
+    // 保守的な判定なので、指数時間にならないパターンを検出することもある
+    template<typename Tree>
+    constexpr auto find_backtracking_hazard(const Tree& tree) -> backtracking_hazard {
+      for (std::size_t i = 0; i < tree.node_count; ++i) {
+        const auto& node = tree.nodes[i];
+        if (node.kind != node_kind::repeat or node.last < hazard_repeat_count) continue;
+
+        const auto body_first = first_chars_of(tree, node.child);
+
+        // 内側の繰り返しを続けるか、外側の次の繰り返しを始めるかを選べる
+        constexpr_vector<std::size_t> inner;
+        trailing_repeats(tree, node.child, inner);
+        for (const auto r : inner) {
+          if (first_chars_of(tree, tree.nodes[r].child).overlaps(body_first)) {
+            return {hazard_kind::nested_quantifier, i};
+          }
+        }
+
+        // 1回の繰り返しの中で、同じ文字を前後どちらの要素でも消費できる
+        if (has_overlapping_sequence(tree, node.child)) {
+          return {hazard_kind::overlapping_sequence, i};
+        }
+
+        // どちらの選択肢でも同じ文字を消費できる
+        auto body = node.child;
+        while (tree.nodes[body].kind == node_kind::capture or tree.nodes[body].kind == node_kind::group) {
+          body = tree.nodes[body].child;
+        }
+        if (tree.nodes[body].kind != node_kind::alternation) continue;
+
+        constexpr_vector<first_chars> alternatives;
+        for (auto c = tree.nodes[body].child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto f = first_chars_of(tree, c);
+          for (const auto& prev : alternatives) {
+            if (prev.overlaps(f)) {
+              return {hazard_kind::ambiguous_alternation, i};
+            }
+          }
+          alternatives.push_back(f);
+        }
+      }
+
+      return {};
+    }
+
+    template<typename Tree>
+    constexpr void check_backtracking(const Tree& tree) {
+      switch (find_backtracking_hazard(tree).kind) {
+      case hazard_kind::nested_quantifier:
+        REGEX_PATTERN_ERROR("Nested quantifiers matching the same characters can cause catastrophic backtracking.");
+      case hazard_kind::ambiguous_alternation:
+        REGEX_PATTERN_ERROR("Alternatives starting with the same characters under a quantifier can cause catastrophic backtracking.");
+      case hazard_kind::overlapping_sequence:
+        REGEX_PATTERN_ERROR("A sequence under a quantifier that can split the same characters in several ways can cause catastrophic backtracking.");
+      default:
+        return;
+      }
+    }
+
+    // 全てのマッチが入力の先頭（endなら末尾）のアサーションに固定されているか
+    template<typename Tree>
+    constexpr auto is_anchored(const Tree& tree, std::size_t index, bool end) -> bool {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+      {
+        auto target = node.child;
+        if (end) {
+          for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+            target = c;
+          }
+        }
+        return target != syntax_node::npos and is_anchored(tree, target, end);
+      }
+      case node_kind::alternation:
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          if (not is_anchored(tree, c, end)) return false;
+        }
+        return true;
+      case node_kind::capture: [[fallthrough]];
+      case node_kind::group:
+        return is_anchored(tree, node.child, end);
+      case node_kind::repeat:
+        return 0 < node.first and is_anchored(tree, node.child, end);
+      case node_kind::line_begin:
+        return not end;
+      case node_kind::line_end:
+        return end;
+      default:
+        return false;
+      }
+    }
+
+    template<typename Tree>
+    constexpr auto make_start_filter(const Tree& tree) -> start_filter {
+      start_filter filter{};
+      filter.anchored = is_anchored(tree, tree.root, false);
+
+      if constexpr (std::same_as<typename Tree::char_type, char>) {
+        const auto first = first_chars_of(tree, tree.root);
+
+        // 空文字列にマッチし得るなら、どの位置からでもマッチし得る
+        if (not first.nullable and std::ranges::any_of(first.bytes.words, [](auto w) { return w != ~std::uint64_t(0); })) {
+          filter.has_first = true;
+          filter.first = first.bytes;
+        }
+      }
+
+      return filter;
+    }
+
+    // 定数式で保持可能なNFA
+    template<std::size_t Insts, std::size_t Sets>
+    struct static_nfa {
+      std::array<nfa_inst, Insts> insts{};
+      std::array<char_bitmap, Sets> sets{};
+
+      constexpr static_nfa(const nfa_program& prog) {
+        std::ranges::copy(prog.insts, insts.begin());
+        std::ranges::copy(prog.sets, sets.begin());
+      }
+    };
+  }
+
+  // NFAの全ての状態を同時に辿る（Pike VM）ことで、バックトラックせずに入力長に線形な時間で照合する
+  // 結果はECMAScriptのバックトラックと同じく、最も左で優先順位の高いマッチになる
+  template<fixed_string Pattern>
+  class pike_regex {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+
+    static constexpr auto tree = parse<Pattern>();
+
+    using match_type = match_result<char_type, tree.capture_group_count + 1>;
+
+  private:
+    static constexpr std::size_t npos = syntax_node::npos;
+    static constexpr std::size_t slot_count = 2 * match_type::size();
+
+    using slots_type = std::array<std::size_t, slot_count>;
+
+    // マッチの開始位置の候補
+    static constexpr auto starts = detail::make_start_filter(tree);
+
+    static constexpr auto program = detail::static_nfa<detail::compile_nfa(tree).insts.size(), detail::compile_nfa(tree).sets.size()>{detail::compile_nfa(tree)};
+
+    // 優先順位順に並んだスレッド
+    // 各pcは1つのリストに高々1度しか入らないので、最初に全ての領域を確保しておけば検索中に確保し直さない
+    struct thread_list {
+      detail::constexpr_vector<std::size_t> order;
+      // pcごとに、最後に追加された時の位置
+      detail::constexpr_vector<std::size_t> mark;
+      detail::constexpr_vector<slots_type> slots;
+
+      constexpr thread_list()
+        : mark(program.insts.size(), npos)
+        , slots(program.insts.size())
+      {
+        order.reserve(program.insts.size());
+      }
+
+      explicit thread_list(std::pmr::memory_resource* resource)
+        : order(resource)
+        , mark(program.insts.size(), npos, resource)
+        , slots(program.insts.size(), slots_type{}, resource)
+      {
+        order.reserve(program.insts.size());
+      }
+
+      // 領域を残したまま空にする
+      constexpr void reset() {
+        order.clear();
+        std::ranges::fill(mark, npos);
+      }
+    };
+
+  public:
+    // 検索の間で使い回すスレッドリスト
+    // 構築した後は、何度検索してもメモリを確保しない
+    struct scratch_type {
+      thread_list current{};
+      thread_list next{};
+
+      constexpr scratch_type() = default;
+
+      // 領域をresourceから確保する
+      explicit scratch_type(std::pmr::memory_resource* resource)
+        : current(resource)
+        , next(resource)
+      {}
+    };
+
+  private:
+
+    // pcからε遷移を辿って、入力を待つスレッドをlistに追加する
+    fn add_thread(thread_list& list, std::size_t pc, view_type input, std::size_t pos, slots_type& slots) -> void {
+      if (list.mark[pc] == pos) return;
+      list.mark[pc] = pos;
+
+      const auto& inst = program.insts[pc];
+
+      switch (inst.op) {
+      case detail::nfa_op::jump:
+        add_thread(list, inst.x, input, pos, slots);
+        return;
+      case detail::nfa_op::split:
+        add_thread(list, inst.x, input, pos, slots);
+        add_thread(list, inst.y, input, pos, slots);
+        return;
+      case detail::nfa_op::save:
+      {
+        const auto saved = slots[inst.x];
+        slots[inst.x] = pos;
+        add_thread(list, pc + 1, input, pos, slots);
+        slots[inst.x] = saved;
+        return;
+      }
+      case detail::nfa_op::clear:
+      {
+        const auto saved = slots;
+        std::fill(slots.begin() + inst.x, slots.begin() + inst.y, npos);
+        add_thread(list, pc + 1, input, pos, slots);
+        slots = saved;
+        return;
+      }
+      case detail::nfa_op::assert_begin:
+        if (pos == 0) add_thread(list, pc + 1, input, pos, slots);
+        return;
+      case detail::nfa_op::assert_end:
+        if (pos == input.size()) add_thread(list, pc + 1, input, pos, slots);
+        return;
+      case detail::nfa_op::assert_word_boundary: [[fallthrough]];
+      case detail::nfa_op::assert_not_word_boundary:
+      {
+        const bool prev = 0 < pos and detail::is_word_code(to_code(input[pos - 1]));
+        const bool next = pos < input.size() and detail::is_word_code(to_code(input[pos]));
+        if ((prev != next) == (inst.op == detail::nfa_op::assert_word_boundary)) {
+          add_thread(list, pc + 1, input, pos, slots);
+        }
+        return;
+      }
+      default:
+        list.order.push_back(pc);
+        list.slots[pc] = slots;
+        return;
+      }
+    }
+
+    fn accepts(const detail::nfa_inst& inst, char_type c) -> bool {
+      if constexpr (sizeof(char_type) == 1) {
+        return program.sets[inst.x].test(to_code(c));
+      } else {
+        return detail::node_accepts(tree, tree.nodes[inst.y], to_code(c));
+      }
+    }
+
+    // fromから照合する、anchoredならfromから始まるマッチだけを、fullなら入力の末尾で終わるマッチだけを探す
+    fn run(view_type input, std::size_t from, bool anchored, bool full, scratch_type& scratch) -> match_type {
+      auto& current = scratch.current;
+      auto& next = scratch.next;
+      current.reset();
+      next.reset();
+
+      slots_type slots{};
+      slots_type found{};
+      bool matched = false;
+
+      for (auto pos = from; ; ++pos) {
+        if (not matched and not anchored and current.order.empty()) {
+          // 実行中のスレッドが無ければ、開始位置の候補まで読み飛ばす
+          pos = starts.next(input, pos);
+          if (pos == npos) break;
+        }
+
+        // 新しいスレッドはそれまでのスレッドより優先順位が低い
+        if (not matched and (not anchored or pos == from)) {
+          slots.fill(npos);
+          slots[0] = pos;
+          add_thread(current, 0, input, pos, slots);
+        }
+
+        next.order.clear();
+
+        for (const auto pc : current.order) {
+          const auto& inst = program.insts[pc];
+
+          if (inst.op == detail::nfa_op::match) {
+            if (full and pos != input.size()) continue;
+
+            // 優先順位の低いスレッドは捨てる
+            matched = true;
+            found = current.slots[pc];
+            found[1] = pos;
+            break;
+          }
+
+          if (pos < input.size() and accepts(inst, input[pos])) {
+            slots = current.slots[pc];
+            add_thread(next, pc + 1, input, pos + 1, slots);
+          }
+        }
+
+        std::swap(current, next);
+
+        if (pos == input.size() or (current.order.empty() and (matched or anchored))) break;
+      }
+
+      if (not matched) return {};
+
+      auto groups = match_type::unmatched_groups();
+      for (std::size_t i = 0; i < groups.size(); ++i) {
+        if (found[2 * i] != npos and found[2 * i + 1] != npos) {
+          groups[i] = {found[2 * i], found[2 * i + 1]};
+        }
+      }
+
+      return {input, groups};
+    }
+
+  public:
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    static constexpr auto match(view_type input) -> match_type {
+      scratch_type scratch{};
+      return run(input, 0, true, true, scratch);
+    }
+
+    // scratchを使い回して照合する
+    [[nodiscard]]
+    static constexpr auto match(view_type input, scratch_type& scratch) -> match_type {
+      return run(input, 0, true, true, scratch);
+    }
+
+    // fromの位置以降で最初にマッチする部分を探す
+    [[nodiscard]]
+    static constexpr auto search(view_type input, std::size_t from = 0) -> match_type {
+      scratch_type scratch{};
+      return search(input, from, scratch);
+    }
+
+    // scratchを使い回して検索する、2回目以降はメモリを確保しない
+    [[nodiscard]]
+    static constexpr auto search(view_type input, std::size_t from, scratch_type& scratch) -> match_type {
+      if (input.size() < from) return {};
+      return run(input, from, false, false, scratch);
+    }
+
+    [[nodiscard]]
+    static constexpr auto searches(view_type input) {
+      return rime::regex_searches(input, pike_regex{});
+    }
+  };
+
+  namespace detail {
+
+    // 飽和する長さの演算
+    constexpr auto length_add(std::size_t a, std::size_t b) -> std::size_t {
+      if (a == syntax_node::npos or b == syntax_node::npos or syntax_node::npos - a <= b) return syntax_node::npos;
+      return a + b;
+    }
+
+    constexpr auto length_mul(std::size_t a, std::size_t b) -> std::size_t {
+      if (a == 0 or b == 0) return 0;
+      if (a == syntax_node::npos or b == syntax_node::npos or syntax_node::npos / a <= b) return syntax_node::npos;
+      return a * b;
+    }
+
+    // ノードがマッチする文字列長の[最小, 最大]、上限が無ければnpos
+    template<typename Tree>
+    constexpr auto length_bounds(const Tree& tree, std::size_t index) -> std::pair<std::size_t, std::size_t> {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+      {
+        std::pair<std::size_t, std::size_t> bounds{0, 0};
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto [min, max] = length_bounds(tree, c);
+          bounds = {length_add(bounds.first, min), length_add(bounds.second, max)};
+        }
+        return bounds;
+      }
+      case node_kind::alternation:
+      {
+        std::pair<std::size_t, std::size_t> bounds{syntax_node::npos, 0};
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto [min, max] = length_bounds(tree, c);
+          bounds = {std::min(bounds.first, min), std::max(bounds.second, max)};
+        }
+        return bounds;
+      }
+      case node_kind::character: [[fallthrough]];
+      case node_kind::any: [[fallthrough]];
+      case node_kind::char_class:
+        return {1, 1};
+      case node_kind::back_reference:
+        return {0, syntax_node::npos};
+      case node_kind::capture: [[fallthrough]];
+      case node_kind::group:
+        return length_bounds(tree, node.child);
+      case node_kind::repeat:
+      {
+        const auto [min, max] = length_bounds(tree, node.child);
+        return {length_mul(min, node.first), length_mul(max, node.last)};
+      }
+      default:
+        // アサーション
+        return {0, 0};
+      }
+    }
+
+    // マッチの先頭から並ぶ要素、literalでなければ長さの範囲だけを持つ
+    struct sequence_element {
+      bool literal = false;
+      std::size_t code = 0;
+      std::size_t min = 0;
+      std::size_t max = 0;
+    };
+
+    // 連接をグループの内側まで平坦化する
+    template<typename Tree>
+    constexpr void flatten_sequence(const Tree& tree, std::size_t index, constexpr_vector<sequence_element>& out) {
+      using unsigned_type = std::make_unsigned_t<typename Tree::char_type>;
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation:
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          flatten_sequence(tree, c, out);
+        }
+        return;
+      case node_kind::capture: [[fallthrough]];
+      case node_kind::group:
+        flatten_sequence(tree, node.child, out);
+        return;
+      case node_kind::character:
+        // 文字型で表せない文字はリテラルとして扱わない
+        if (node.first <= std::numeric_limits<unsigned_type>::max()) {
+          out.push_back({true, node.first, 1, 1});
+          return;
+        }
+        break;
+      case node_kind::repeat:
+      {
+        // 1文字の繰り返しは、必ず現れる回数分だけリテラルにする
+        const auto& child = tree.nodes[node.child];
+        if (child.kind == node_kind::character and 0 < node.first and node.first <= tree.nodes.size() and child.first <= std::numeric_limits<unsigned_type>::max()) {
+          for (std::size_t i = 0; i < node.first; ++i) {
+            out.push_back({true, child.first, 1, 1});
+          }
+          if (node.last != node.first) {
+            out.push_back({false, 0, 0, node.last == syntax_node::npos ? syntax_node::npos : node.last - node.first});
+          }
+          return;
+        }
+        break;
+      }
+      default:
+        break;
+      }
+
+      const auto [min, max] = length_bounds(tree, index);
+      out.push_back({false, 0, min, max});
+    }
+
+    // 一般的なテキストでの出現頻度の高いバイト、前ほど頻出
+    inline constexpr std::string_view common_bytes = " etaoinsrhldcumfpgwybvkxjqz0123456789ETAOINSRHLDCUMFPGWYBVKXJQZ,.-_:/=\"'\t\n";
+
+    // 小さいほど稀なバイト
+    constexpr auto byte_frequency_rank(std::size_t c) -> std::size_t {
+      const auto n = (c < 128) ? common_bytes.find(char(c)) : std::string_view::npos;
+      return (n == std::string_view::npos) ? 0 : common_bytes.size() - n;
+    }
+
+    // 全てのマッチに含まれるリテラルとその位置の解析結果、Nはリテラルの容量
+    template<regex_usable_character CharT, std::size_t N>
+    struct pattern_analysis {
+      // マッチの長さの範囲
+      std::size_t min_length = 0;
+      std::size_t max_length = 0;
+      // 必須リテラル（無ければ長さ0）
+      std::array<CharT, N> literal{};
+      std::size_t literal_length = 0;
+      // マッチの先頭からリテラルの先頭までの距離の範囲
+      std::size_t literal_offset_min = 0;
+      std::size_t literal_offset_max = 0;
+      // リテラルの中で最も稀な文字の位置
+      std::size_t rare_index = 0;
+
+      constexpr auto literal_view() const -> std::basic_string_view<CharT> {
+        return {literal.data(), literal_length};
+      }
+    };
+
+    template<typename Tree>
+    constexpr auto analyze_pattern(const Tree& tree) {
+      using CharT = typename Tree::char_type;
+      constexpr std::size_t N = std::tuple_size_v<decltype(tree.class_items)>;
+
+      pattern_analysis<CharT, N> result{};
+      const auto [min, max] = length_bounds(tree, tree.root);
+      result.min_length = min;
+      result.max_length = max;
+
+      constexpr_vector<sequence_element> seq;
+      flatten_sequence(tree, tree.root, seq);
+
+      // 最も長いリテラルの連続を選ぶ
+      std::size_t best_first = 0, best_length = 0;
+      std::pair<std::size_t, std::size_t> offset{0, 0}, best_offset{0, 0};
+
+      for (std::size_t i = 0; i < seq.size();) {
+        if (not seq[i].literal) {
+          offset = {length_add(offset.first, seq[i].min), length_add(offset.second, seq[i].max)};
+          ++i;
+          continue;
+        }
+
+        auto j = i;
+        while (j < seq.size() and seq[j].literal) ++j;
+
+        if (best_length < j - i) {
+          best_first = i;
+          best_length = j - i;
+          best_offset = offset;
+        }
+
+        offset = {length_add(offset.first, j - i), length_add(offset.second, j - i)};
+        i = j;
+      }
+
+      result.literal_length = std::min(best_length, N);
+      result.literal_offset_min = best_offset.first;
+      result.literal_offset_max = best_offset.second;
+
+      for (std::size_t i = 0; i < result.literal_length; ++i) {
+        result.literal[i] = CharT(seq[best_first + i].code);
+
+        if (byte_frequency_rank(seq[best_first + i].code) < byte_frequency_rank(seq[best_first + result.rare_index].code)) {
+          result.rare_index = i;
+        }
+      }
+
+      return result;
+    }
+  }
+
+  // std::regexによる照合の前に、全てのマッチに含まれるリテラルで候補位置を絞り込む
+  template<fixed_string Pattern>
+  class compiled_regex {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+
+    static constexpr auto tree = parse<Pattern>();
+    static constexpr auto analysis = detail::analyze_pattern(tree);
+
+    static_assert(not detail::strict_backtracking or not detail::find_backtracking_hazard(tree), "The pattern can cause catastrophic backtracking.");
+
+    using match_type = match_result<char_type, tree.capture_group_count + 1>;
+    // 検索の間で使い回すstd::match_results、memory_resource*から構築できる
+    // std::regexの照合は内部でもメモリを確保するので、これを使い回しても確保は無くならない
+    using scratch_type = std::pmr::match_results<const char_type*>;
+
+  private:
+    // マッチの開始位置の候補
+    static constexpr auto starts = detail::make_start_filter(tree);
+
+    std::basic_regex<char_type> m_regex{Pattern.str, Pattern.size()};
+
+    // std::regex_searchの結果をmatch_typeに変換する
+    auto regex_search_at(view_type input, std::size_t first, std::regex_constants::match_flag_type flags, scratch_type& m) const -> match_type {
+      if (0 < first) flags |= std::regex_constants::match_prev_avail;
+      if (not std::regex_search(input.data() + first, input.data() + input.size(), m, m_regex, flags)) {
+        return {};
+      }
+
+      auto groups = match_type::unmatched_groups();
+      for (std::size_t i = 0; i < groups.size(); ++i) {
+        if (m[i].matched) {
+          groups[i] = {std::size_t(m[i].first - input.data()), std::size_t(m[i].second - input.data())};
+        }
+      }
+
+      return {input, groups};
+    }
+
+    // from以降で最初にリテラルが現れる位置
+    static auto find_literal(view_type input, std::size_t from) -> std::size_t {
+      constexpr auto literal = analysis.literal_view();
+      constexpr auto rare = analysis.rare_index;
+
+      for (auto pos = from; pos + literal.size() <= input.size();) {
+        // 稀な文字をmemchr（wmemchr）で探してから、リテラル全体を比較する
+        const auto* p = std::char_traits<char_type>::find(input.data() + pos + rare, input.size() - pos - literal.size() + 1, literal[rare]);
+        if (p == nullptr) break;
+
+        const auto candidate = std::size_t(p - input.data()) - rare;
+        if (input.substr(candidate, literal.size()) == literal) {
+          return candidate;
+        }
+        pos = candidate + 1;
+      }
+
+      return view_type::npos;
+    }
+
+  public:
+    compiled_regex() = default;
+
+    auto regex() const -> const std::basic_regex<char_type>& {
+      return m_regex;
+    }
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    auto match(view_type input) const -> match_type {
+      scratch_type scratch;
+      return match(input, scratch);
+    }
+
+    // scratchを使い回して照合する
+    [[nodiscard]]
+    auto match(view_type input, scratch_type& m) const -> match_type {
+      if (input.size() < analysis.min_length) return {};
+
+      if (not std::regex_match(input.data(), input.data() + input.size(), m, m_regex)) {
+        return {};
+      }
+
+      auto groups = match_type::unmatched_groups();
+      for (std::size_t i = 0; i < groups.size(); ++i) {
+        if (m[i].matched) {
+          groups[i] = {std::size_t(m[i].first - input.data()), std::size_t(m[i].second - input.data())};
+        }
+      }
+
+      return {input, groups};
+    }
+
+    // from以降で最初のマッチを探す
+    [[nodiscard]]
+    auto search(view_type input, std::size_t from = 0) const -> match_type {
+      scratch_type scratch;
+      return search(input, from, scratch);
+    }
+
+    // scratchを使い回して検索する
+    [[nodiscard]]
+    auto search(view_type input, std::size_t from, scratch_type& scratch) const -> match_type {
+      constexpr auto npos = syntax_node::npos;
+
+      if (input.size() < from or input.size() - from < analysis.min_length) return {};
+
+      if constexpr (starts.anchored) {
+        // 入力の先頭からの1回だけ試す
+        if (from != 0) return {};
+        if constexpr (analysis.literal_length != 0) {
+          if (find_literal(input, analysis.literal_offset_min) == npos) return {};
+        }
+        return regex_search_at(input, 0, std::regex_constants::match_continuous, scratch);
+      } else if constexpr (analysis.literal_length == 0) {
+        if constexpr (starts.has_first) {
+          // 先頭の文字になり得る位置だけを試す
+          for (auto start = starts.next(input, from); start != npos; start = starts.next(input, start + 1)) {
+            if (auto m = regex_search_at(input, start, std::regex_constants::match_continuous, scratch)) {
+              return m;
+            }
+          }
+          return {};
+        } else {
+          return regex_search_at(input, from, std::regex_constants::match_default, scratch);
+        }
+      } else {
+        for (auto pos = from; ;) {
+          // マッチの開始位置がfrom以降なら、リテラルはfrom + literal_offset_min以降にある
+          const auto lit = find_literal(input, detail::length_add(pos, analysis.literal_offset_min));
+          if (lit == npos) return {};
+
+          if constexpr (analysis.literal_offset_max == npos) {
+            // マッチの開始位置の範囲が絞れないので、一度だけ検索する
+            return regex_search_at(input, pos, std::regex_constants::match_default, scratch);
+          } else {
+            // リテラルの位置から決まる開始位置の候補を順に試す
+            const auto first = std::max(pos, lit - std::min(lit, analysis.literal_offset_max));
+            const auto last = lit - analysis.literal_offset_min;
+
+            for (auto start = starts.next(input, first); start != npos and start <= last; start = starts.next(input, start + 1)) {
+              if (auto m = regex_search_at(input, start, std::regex_constants::match_continuous, scratch)) {
+                return m;
+              }
+            }
+
+            pos = last + 1;
+          }
+        }
+      }
+    }
+
+    // 入力文字列の中からパターンにマッチする部分を全て検索する
+    [[nodiscard]]
+    auto searches(view_type input) const {
+      return ranges::regex_search_view<compiled_regex>{input, *this};
+    }
+  };
+
+  namespace detail {
+
+    // パターンが文字だけの連接（リテラル）か
+    template<typename Tree>
+    constexpr auto is_literal_pattern(const Tree& tree) -> bool {
+      using unsigned_type = std::make_unsigned_t<typename Tree::char_type>;
+      const auto& root = tree.nodes[tree.root];
+
+      if (root.kind != node_kind::concatenation) return false;
+
+      for (auto c = root.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+        const auto& node = tree.nodes[c];
+        if (node.kind != node_kind::character or std::numeric_limits<unsigned_type>::max() < node.first) {
+          return false;
+        }
+      }
+
+      return true;
+    }
+  }
+
+  // リテラルだけのパターンを、std::regexを使わずにBoyer-Moore-Horspool法で検索する
+  template<fixed_string Pattern>
+  class literal_regex {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = match_result<char_type, 1>;
+
+    static constexpr auto tree = parse<Pattern>();
+
+    static_assert(detail::is_literal_pattern(tree), "The pattern is not a literal.");
+
+  private:
+    // エスケープをデコードしたリテラル
+    static constexpr auto storage = [] {
+      std::array<char_type, Pattern.size()> str{};
+      std::size_t n = 0;
+
+      for (auto c = tree.nodes[tree.root].child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+        str[n++] = char_type(tree.nodes[c].first);
+      }
+
+      return std::pair{str, n};
+    }();
+
+  public:
+    static constexpr view_type literal{storage.first.data(), storage.second};
+
+  private:
+    std::boyer_moore_horspool_searcher<const char_type*> m_searcher{literal.data(), literal.data() + literal.size()};
+
+    static constexpr auto make_match(view_type input, std::size_t pos) -> match_type {
+      return {input, {{{pos, pos + literal.size()}}}};
+    }
+
+  public:
+    literal_regex() = default;
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    auto match(view_type input) const -> match_type {
+      return (input == literal) ? make_match(input, 0) : match_type{};
+    }
+
+    // from以降で最初のマッチを探す
+    [[nodiscard]]
+    auto search(view_type input, std::size_t from = 0) const -> match_type {
+      if (input.size() < from or input.size() - from < literal.size()) return {};
+
+      if constexpr (literal.size() <= 1) {
+        if constexpr (literal.empty()) {
+          return make_match(input, from);
+        } else {
+          // 1文字ならmemchr（wmemchr）
+          const auto* p = std::char_traits<char_type>::find(input.data() + from, input.size() - from, literal[0]);
+          return p ? make_match(input, std::size_t(p - input.data())) : match_type{};
+        }
+      } else {
+        const auto* const last = input.data() + input.size();
+        const auto [first, _] = m_searcher(input.data() + from, last);
+
+        return (first != last) ? make_match(input, std::size_t(first - input.data())) : match_type{};
+      }
+    }
+
+    // 入力文字列の中からパターンにマッチする部分を全て検索する
+    [[nodiscard]]
+    auto searches(view_type input) const {
+      return ranges::regex_search_view<literal_regex>{input, *this};
+    }
+  };
+
+  // literal_setの検索結果、indexはマッチした単語の番号
+  struct set_match {
+    static constexpr std::size_t npos = syntax_node::npos;
+
+    std::size_t position = npos;
+    std::size_t length = 0;
+    std::size_t index = npos;
+
+    constexpr explicit operator bool() const noexcept {
+      return position != npos;
+    }
+  };
+
+  namespace detail {
+
+    // Aho-Corasickオートマトンの構築結果
+    struct aho_corasick_data {
+      // 文字の同値類、0はどの単語にも含まれない文字
+      std::array<std::size_t, 256> byte_class{};
+      // 256以上の文字コード（昇順）、i番目の同値類は256未満の文字の同値類の後に続く
+      constexpr_vector<std::size_t> wide_codes;
+      std::size_t class_count = 1;
+      std::size_t state_count = 1;
+      // 失敗遷移を畳み込んだ遷移表、state * class_count + cls で引く
+      constexpr_vector<std::size_t> next;
+      // トライでの深さ（状態の表す文字列の長さ）
+      constexpr_vector<std::size_t> depth;
+      // 状態の表す文字列の接尾辞になっている最長の単語の長さ
+      constexpr_vector<std::size_t> out_length;
+      // 状態の表す文字列と一致する単語の最小の番号
+      constexpr_vector<std::size_t> word_index;
+    };
+
+    constexpr auto build_aho_corasick(const constexpr_vector<constexpr_vector<std::size_t>>& words) -> aho_corasick_data {
+      constexpr auto npos = syntax_node::npos;
+      aho_corasick_data ac{};
+
+      // 単語に含まれる文字ごとに同値類を割り当てる
+      for (const auto& word : words) {
+        for (const auto c : word) {
+          if (c < 256) {
+            if (ac.byte_class[c] == 0) ac.byte_class[c] = ac.class_count++;
+          } else if (std::ranges::find(ac.wide_codes, c) == ac.wide_codes.end()) {
+            ac.wide_codes.push_back(c);
+          }
+        }
+      }
+      std::ranges::sort(ac.wide_codes);
+      ac.class_count += ac.wide_codes.size();
+
+      const auto class_of = [&](std::size_t c) -> std::size_t {
+        if (c < 256) return ac.byte_class[c];
+        return ac.class_count - ac.wide_codes.size() + char_to_num(ac.wide_codes, c);
+      };
+      const auto add_state = [&](std::size_t d) {
+        ac.next.resize(ac.next.size() + ac.class_count, npos);
+        ac.depth.push_back(d);
+        ac.out_length.push_back(0);
+        ac.word_index.push_back(npos);
+        return ac.depth.size() - 1;
+      };
+
+      // トライ
+      add_state(0);
+      for (std::size_t i = 0; i < words.size(); ++i) {
+        std::size_t s = 0;
+        for (const auto c : words[i]) {
+          auto& t = ac.next[s * ac.class_count + class_of(c)];
+          if (t == npos) {
+            const auto d = ac.depth[s] + 1;
+            const auto u = add_state(d);
+            ac.next[s * ac.class_count + class_of(c)] = u;
+          }
+          s = ac.next[s * ac.class_count + class_of(c)];
+        }
+        ac.word_index[s] = std::min(ac.word_index[s], i);
+        ac.out_length[s] = ac.depth[s];
+      }
+      ac.state_count = ac.depth.size();
+
+      // 幅優先で失敗遷移を求め、遷移表に畳み込む
+      constexpr_vector<std::size_t> fail(ac.state_count, 0);
+      constexpr_vector<std::size_t> queue{0};
+
+      for (std::size_t q = 0; q < queue.size(); ++q) {
+        const auto s = queue[q];
+
+        for (std::size_t cls = 0; cls < ac.class_count; ++cls) {
+          auto& t = ac.next[s * ac.class_count + cls];
+          const auto fallback = (s == 0) ? 0 : ac.next[fail[s] * ac.class_count + cls];
+
+          if (t == npos) {
+            t = fallback;
+            continue;
+          }
+
+          fail[t] = fallback;
+          if (ac.out_length[t] == 0) ac.out_length[t] = ac.out_length[fallback];
+          queue.push_back(t);
+        }
+      }
+
+      return ac;
+    }
+
+    // 定数式で保持可能なAho-Corasickオートマトン
+    template<regex_usable_character CharT, std::size_t States, std::size_t Classes, std::size_t Wide>
+    struct aho_corasick {
+      using view_type = std::basic_string_view<CharT>;
+
+      std::array<std::uint32_t, 256> byte_class{};
+      std::array<std::size_t, Wide> wide_codes{};
+      // 状態は遷移表の行の先頭位置（状態番号 * Classes）で表す
+      std::array<std::uint32_t, States * Classes> next{};
+      std::array<std::size_t, States> depth{};
+      std::array<std::size_t, States> out_length{};
+      std::array<std::size_t, States> word_index{};
+
+      constexpr aho_corasick(const aho_corasick_data& ac) {
+        for (std::size_t c = 0; c < 256; ++c) {
+          byte_class[c] = std::uint32_t(ac.byte_class[c]);
+        }
+        std::ranges::copy(ac.wide_codes, wide_codes.begin());
+
+        for (std::size_t s = 0; s < States; ++s) {
+          for (std::size_t cls = 0; cls < Classes; ++cls) {
+            next[s * Classes + cls] = std::uint32_t(ac.next[s * Classes + cls] * Classes);
+          }
+          depth[s] = ac.depth[s];
+          out_length[s] = ac.out_length[s];
+          word_index[s] = ac.word_index[s];
+        }
+      }
+
+      constexpr auto class_of(CharT ch) const -> std::size_t {
+        const auto c = to_code(ch);
+        if (c < 256) return byte_class[c];
+
+        if constexpr (Wide == 0) {
+          return 0;
+        } else {
+          const auto it = std::ranges::lower_bound(wide_codes, c);
+          return (it != wide_codes.end() and *it == c) ? Classes - Wide + std::size_t(it - wide_codes.begin()) : 0;
+        }
+      }
+
+      // from以降で最も左から始まる単語を探し、同じ位置から始まる単語の中では番号の小さいものを選ぶ
+      constexpr auto find(view_type input, std::size_t from) const -> set_match {
+        constexpr auto npos = set_match::npos;
+
+        std::size_t s = 0;
+        std::size_t first = npos;
+
+        for (auto i = from; i < input.size(); ++i) {
+          s = next[s + class_of(input[i])];
+
+          const auto state = s / Classes;
+          if (out_length[state] != 0) {
+            first = std::min(first, i + 1 - out_length[state]);
+          }
+          // 進行中の照合がfirstより前から始まっていなければ確定する
+          if (first != npos and first <= i + 1 - depth[state]) break;
+        }
+
+        if (first == npos) return {};
+
+        // firstからトライを辿って、番号の最も小さい単語を選ぶ
+        set_match result{first, 0, npos};
+        std::size_t t = 0;
+
+        for (auto i = first; i < input.size(); ++i) {
+          const auto u = next[t + class_of(input[i])];
+          if (depth[u / Classes] != depth[t / Classes] + 1) break;
+
+          t = u;
+          if (word_index[t / Classes] < result.index) {
+            result.index = word_index[t / Classes];
+            result.length = depth[t / Classes];
+          }
+        }
+
+        return result;
+      }
+
+      // 入力全体と一致する単語
+      constexpr auto match(view_type input) const -> set_match {
+        std::size_t t = 0;
+
+        for (const auto c : input) {
+          const auto u = next[t + class_of(c)];
+          if (depth[u / Classes] != depth[t / Classes] + 1) return {};
+          t = u;
+        }
+
+        const auto index = word_index[t / Classes];
+        return (index != set_match::npos) ? set_match{0, input.size(), index} : set_match{};
+      }
+    };
+
+    // 単語の列からAho-Corasickオートマトンを構築する、Wordsは単語の列を返す関数オブジェクト
+    template<regex_usable_character CharT, auto Words>
+    consteval auto make_aho_corasick() {
+      constexpr auto data = [] { return build_aho_corasick(Words()); };
+      constexpr auto states = data().state_count;
+      constexpr auto classes = data().class_count;
+      constexpr auto wide = data().wide_codes.size();
+
+      return aho_corasick<CharT, states, classes, wide>{data()};
+    }
+
+    // パターンが空でないリテラルの選言か
+    template<typename Tree>
+    constexpr auto is_literal_alternation(const Tree& tree) -> bool {
+      using unsigned_type = std::make_unsigned_t<typename Tree::char_type>;
+      const auto& root = tree.nodes[tree.root];
+
+      if (root.kind != node_kind::alternation) return false;
+
+      for (auto a = root.child; a != syntax_node::npos; a = tree.nodes[a].sibling) {
+        const auto& alt = tree.nodes[a];
+        if (alt.kind != node_kind::concatenation or alt.child == syntax_node::npos) return false;
+
+        for (auto c = alt.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          const auto& node = tree.nodes[c];
+          if (node.kind != node_kind::character or std::numeric_limits<unsigned_type>::max() < node.first) {
+            return false;
+          }
+        }
+      }
+
+      return true;
+    }
+  }
+
+  // 単語の集合を同時に検索する、検索時間は単語の数によらない
+  template<fixed_string Word, fixed_string... Words>
+  class literal_set {
+  public:
+    using char_type = typename decltype(Word)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = match_result<char_type, 1>;
+
+    static_assert((std::same_as<char_type, typename decltype(Words)::char_type> and ...), "All words must have the same character type.");
+    static_assert(Word.size() != 0 and ((Words.size() != 0) and ...), "Empty words are not allowed.");
+
+    static constexpr std::size_t size = 1 + sizeof...(Words);
+
+  private:
+    static constexpr auto words = [] {
+      detail::constexpr_vector<detail::constexpr_vector<std::size_t>> result;
+
+      const auto add = [&](view_type word) {
+        auto& codes = result.emplace_back();
+        for (const auto c : word) codes.push_back(to_code(c));
+      };
+      add(Word.view());
+      (add(Words.view()), ...);
+
+      return result;
+    };
+
+  public:
+    static constexpr auto automaton = detail::make_aho_corasick<char_type, words>();
+
+    // from以降で最初に現れる単語とその番号、同じ位置から始まる単語が複数あれば番号の小さい方
+    [[nodiscard]]
+    static constexpr auto find(view_type input, std::size_t from = 0) -> set_match {
+      return automaton.find(input, from);
+    }
+
+    // 入力文字列全体と一致する単語
+    [[nodiscard]]
+    static constexpr auto match(view_type input) -> match_type {
+      return automaton.match(input) ? match_type{input, {{{0, input.size()}}}} : match_type{};
+    }
+
+    [[nodiscard]]
+    static constexpr auto search(view_type input, std::size_t from = 0) -> match_type {
+      const auto m = automaton.find(input, from);
+      return m ? match_type{input, {{{m.position, m.position + m.length}}}} : match_type{};
+    }
+
+    [[nodiscard]]
+    static constexpr auto searches(view_type input) {
+      return ranges::regex_search_view<literal_set>{input, literal_set{}};
+    }
+  };
+
+  // リテラルの選言（GET|POST|PUT）を、std::regexを使わずにAho-Corasick法で検索する
+  template<fixed_string Pattern>
+  class literal_alternation {
+  public:
+    using char_type = typename decltype(Pattern)::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = match_result<char_type, 1>;
+
+    static constexpr auto tree = parse<Pattern>();
+
+    static_assert(detail::is_literal_alternation(tree), "The pattern is not an alternation of literals.");
+
+  private:
+    static constexpr auto words = [] {
+      detail::constexpr_vector<detail::constexpr_vector<std::size_t>> result;
+
+      for (auto a = tree.nodes[tree.root].child; a != syntax_node::npos; a = tree.nodes[a].sibling) {
+        auto& codes = result.emplace_back();
+        for (auto c = tree.nodes[a].child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          codes.push_back(tree.nodes[c].first);
+        }
+      }
+
+      return result;
+    };
+
+  public:
+    static constexpr auto automaton = detail::make_aho_corasick<char_type, words>();
+
+    // 入力文字列全体がマッチするか
+    [[nodiscard]]
+    static constexpr auto match(view_type input) -> match_type {
+      return automaton.match(input) ? match_type{input, {{{0, input.size()}}}} : match_type{};
+    }
+
+    // from以降で最初のマッチを探す、ECMAScriptと同じく同じ位置では前の選択肢を優先する
+    [[nodiscard]]
+    static constexpr auto search(view_type input, std::size_t from = 0) -> match_type {
+      const auto m = automaton.find(input, from);
+      return m ? match_type{input, {{{m.position, m.position + m.length}}}} : match_type{};
+    }
+
+    // 入力文字列の中からパターンにマッチする部分を全て検索する
+    [[nodiscard]]
+    static constexpr auto searches(view_type input) {
+      return ranges::regex_search_view<literal_alternation>{input, literal_alternation{}};
+    }
+  };
+
+  // パターンを解析して照合に使うエンジンを選ぶ
+  // リテラルはliteral_regex、リテラルの選言はliteral_alternation、破滅的なバックトラックを起こし得るパターンはpike_regex、
+  // それ以外はリテラルによる前処理付きのstd::regex（compiled_regex）
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto regex() {
+    if constexpr (detail::is_literal_pattern(parse<Pattern>())) {
+      return literal_regex<Pattern>{};
+    } else if constexpr (detail::is_literal_alternation(parse<Pattern>())) {
+      return literal_alternation<Pattern>{};
+    } else if constexpr (detail::find_backtracking_hazard(parse<Pattern>())) {
+      return pike_regex<Pattern>{};
+    } else {
+      return compiled_regex<Pattern>{};
+    }
+  }
+
+  namespace detail {
+    // パターンごとに共有するregex<Pattern>()のエンジン、std::regexを持つエンジンは一度だけ構築する
+    template<fixed_string Pattern>
+    auto shared_engine() -> const auto& {
+      static const auto engine = regex<Pattern>();
+      return engine;
+    }
+
+    // static_regex_objectで使われたパターンの一覧
+    // 静的初期化の順序に依存しないよう関数内staticで持つ
+    struct static_regex_registry {
+      std::mutex mutex;
+      constexpr_vector<void(*)()> builders;
+
+      static auto instance() -> static_regex_registry& {
+        static static_regex_registry registry{};
+        return registry;
+      }
+
+      auto add(void(*builder)()) -> bool {
+        std::lock_guard lock{mutex};
+        builders.push_back(builder);
+        return true;
+      }
+
+      auto snapshot() -> constexpr_vector<void(*)()> {
+        std::lock_guard lock{mutex};
+        return builders;
+      }
+    };
+  }
+
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto static_regex_object() -> const std::basic_regex<typename decltype(Pattern)::char_type>&;
+
+  namespace detail {
+    // 起動時にはビルダーの登録だけを行い、std::regexの構築は最初の使用時まで遅らせる
+    template<fixed_string Pattern>
+    inline const bool static_regex_registration = static_regex_registry::instance().add(+[] {
+      static_cast<void>(static_regex_object<Pattern>());
+    });
+  }
+
+  // パターンごとに1つだけ構築されるstd::regexを返す
+  // 構築は最初の呼び出し時に1度だけ行われ、複数スレッドから呼び出しても安全
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto static_regex_object() -> const std::basic_regex<typename decltype(Pattern)::char_type>& {
+    using CharT = typename decltype(Pattern)::char_type;
+
+    static constexpr auto tree = parse<Pattern>();
+    static_assert(not detail::strict_backtracking or not detail::find_backtracking_hazard(tree), "The pattern can cause catastrophic backtracking.");
+
+    static_cast<void>(detail::static_regex_registration<Pattern>);
+
+    static const std::basic_regex<CharT> re(Pattern.str, Pattern.size());
+    return re;
+  }
+
+  namespace detail {
+    // parallel_forが使うスレッドの数、threadsが0ならstd::thread::hardware_concurrency()
+    inline auto parallel_worker_count(std::size_t count, std::size_t threads) -> std::size_t {
+      if (threads == 0) {
+        threads = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+      }
+      return std::max<std::size_t>(std::min(threads, count), 1);
+    }
+
+    // task(k, worker)をk = 0, 1, ..., count - 1について呼ぶ
+    // タスクは共有のカウンタから順に取り出すので、早く終わったスレッドが残りを受け持つ
+    // workerは呼び出したスレッドの番号（parallel_worker_count未満）、スレッドごとの作業領域に使う
+    // 最初に投げられた例外は、全てのスレッドが終わってから投げ直す
+    template<typename F>
+    void parallel_for(std::size_t count, std::size_t threads, F&& task) {
+      threads = parallel_worker_count(count, threads);
+
+      if (threads <= 1) {
+        for (std::size_t k = 0; k < count; ++k) task(k, 0);
+        return;
+      }
+
+      std::atomic<std::size_t> next = 0;
+      std::exception_ptr error{};
+      std::mutex error_mutex;
+
+      auto worker = [&](std::size_t w) {
+        for (auto k = next++; k < count; k = next++) {
+          try {
+            task(k, w);
+          } catch (...) {
+            std::lock_guard lock{error_mutex};
+            if (not error) {
+              error = std::current_exception();
+            }
+          }
+        }
+      };
+
+      {
+        std::list<std::jthread> pool{};
+        for (std::size_t w = 1; w < threads; ++w) {
+          pool.emplace_back(worker, w);
+        }
+        worker(0);
+      }
+
+      if (error) {
+        std::rethrow_exception(error);
+      }
+    }
+  }
+
+  // 登録済みのstatic_regex_objectをthreads個のスレッドで構築しておく
+  // threadsが0ならstd::thread::hardware_concurrency()を使う、戻り値は登録されているパターンの数
+  inline auto warm_up_static_regex_objects(std::size_t threads = 0) -> std::size_t {
+    const auto builders = detail::static_regex_registry::instance().snapshot();
+
+    detail::parallel_for(builders.size(), threads, [&](std::size_t i, std::size_t) {
+      builders[i]();
+    });
+    return builders.size();
+  }
+
+  namespace detail {
+
+    enum class format_piece_kind : std::uint8_t {
+      literal,  // 置換文字列の[first, first + length)
+      group,    // $n, $nn, $&（firstがグループ番号）
+      prefix,   // $`
+      suffix,   // $'
+    };
+
+    struct format_piece {
+      format_piece_kind kind = format_piece_kind::literal;
+      std::size_t first = 0;
+      std::size_t length = 0;
+    };
+
+    // コンパイル時に解析した置換文字列、書式はECMAScriptのGetSubstitutionと同じ（存在しないグループの参照はエラー）
+    template<std::size_t N>
+    struct replacement_format {
+      std::array<format_piece, N> pieces{};
+      std::size_t size = 0;
+    };
+
+    template<fixed_string Format>
+    consteval auto parse_format(std::size_t capture_count) {
+      using CharT = typename decltype(Format)::char_type;
+
+      const auto str = Format.view();
+      replacement_format<Format.size() + 1> format{};
+
+      auto push = [&](format_piece_kind kind, std::size_t first, std::size_t length) {
+        // 連続するリテラルはまとめる
+        if (kind == format_piece_kind::literal and 0 < format.size) {
+          auto& back = format.pieces[format.size - 1];
+          if (back.kind == format_piece_kind::literal and back.first + back.length == first) {
+            back.length += length;
+            return;
+          }
+        }
+        format.pieces[format.size++] = {kind, first, length};
+      };
+
+      auto digit = [&](std::size_t i) -> std::size_t {
+        if (str.size() <= i or not is_digit_code(to_code(str[i]))) return syntax_node::npos;
+        return std::size_t(to_code(str[i]) - 0x30);
+      };
+
+      for (std::size_t i = 0; i < str.size(); ++i) {
+        if (str[i] != LITERAL(CharT, '$') or str.size() <= i + 1) {
+          push(format_piece_kind::literal, i, 1);
+          continue;
+        }
+
+        const auto c = str[i + 1];
+
+        if (c == LITERAL(CharT, '$')) {
+          push(format_piece_kind::literal, i + 1, 1);
+          ++i;
+        } else if (c == LITERAL(CharT, '&')) {
+          push(format_piece_kind::group, 0, 0);
+          ++i;
+        } else if (c == LITERAL(CharT, '`')) {
+          push(format_piece_kind::prefix, 0, 0);
+          ++i;
+        } else if (c == LITERAL(CharT, '\'')) {
+          push(format_piece_kind::suffix, 0, 0);
+          ++i;
+        } else if (const auto d1 = digit(i + 1); d1 != syntax_node::npos) {
+          // ECMAScriptのGetSubstitutionと同じく、2桁の番号がグループとして存在しなければ1桁と解釈する
+          const auto d2 = digit(i + 2);
+          std::size_t digits = (d2 != syntax_node::npos) ? 2 : 1;
+          std::size_t index = (digits == 2) ? d1 * 10 + d2 : d1;
+          if (digits == 2 and capture_count < index) {
+            digits = 1;
+            index = d1;
+          }
+
+          if (index == 0) {
+            // $0と$00はグループを参照せず、そのまま書き出す
+            push(format_piece_kind::literal, i, 1 + digits);
+          } else if (index <= capture_count) {
+            push(format_piece_kind::group, index, 0);
+          } else {
+            // GetSubstitutionではそのまま書き出すが、ここでは誤りとして扱う
+            REGEX_PATTERN_ERROR("The format refers to a capture group that does not exist in the pattern.");
+          }
+          i += digits;
+        } else {
+          push(format_piece_kind::literal, i, 1);
+        }
+      }
+
+      return format;
+    }
+  }
+
+  // 1つのマッチを置換文字列Formatに従ってoutに書き出す
+  // last_endは直前のマッチの終わりの位置で、$`はそこからマッチの先頭まで
+  template<fixed_string Format, typename Match, typename Out>
+  constexpr auto format_match(Out out, const Match& m, std::size_t last_end = 0) -> Out {
+    constexpr auto format = detail::parse_format<Format>(Match::size() - 1);
+    constexpr auto str = Format.view();
+
+    const auto input = m.input();
+
+    for (std::size_t i = 0; i < format.size; ++i) {
+      const auto& piece = format.pieces[i];
+
+      switch (piece.kind) {
+      case detail::format_piece_kind::literal:
+        out = std::ranges::copy(str.substr(piece.first, piece.length), std::move(out)).out;
+        break;
+      case detail::format_piece_kind::group:
+        out = std::ranges::copy(m.str(piece.first), std::move(out)).out;
+        break;
+      case detail::format_piece_kind::prefix:
+        out = std::ranges::copy(input.substr(last_end, m.position() - last_end), std::move(out)).out;
+        break;
+      case detail::format_piece_kind::suffix:
+        out = std::ranges::copy(m.suffix(), std::move(out)).out;
+        break;
+      }
+    }
+
+    return out;
+  }
+
+  // パターンにマッチする部分をFormatで置換した結果をoutに書き出す
+  // 置換文字列はコンパイル時に解析され、存在しないキャプチャグループの参照はコンパイルエラーになる
+  // flagsはstd::regex_constants::format_first_onlyとformat_no_copyを解釈する
+  // マッチの列挙はECMAScriptのString.prototype.replaceと同じで、a*?のような空のマッチの扱いはstd::regex_replaceと異なる
+  template<fixed_string Pattern, fixed_string Format, typename Out>
+    requires std::same_as<typename decltype(Pattern)::char_type, typename decltype(Format)::char_type>
+  auto regex_replace(Out out, std::basic_string_view<typename decltype(Pattern)::char_type> input, std::regex_constants::match_flag_type flags = std::regex_constants::format_default) -> Out {
+    // 置換文字列の検査をここで行う
+    [[maybe_unused]] constexpr auto format = detail::parse_format<Format>(parse<Pattern>().capture_group_count);
+
+    const auto& engine = detail::shared_engine<Pattern>();
+    const bool copy = (flags & std::regex_constants::format_no_copy) == 0;
+
+    std::size_t last_end = 0;
+    for (std::size_t pos = 0; pos <= input.size(); ) {
+      const auto m = engine.search(input, pos);
+      if (not m) break;
+
+      if (copy) {
+        out = std::ranges::copy(input.substr(last_end, m.position() - last_end), std::move(out)).out;
+      }
+      out = format_match<Format>(std::move(out), m, last_end);
+
+      last_end = m.end_position();
+      // 空のマッチの後は1文字進めて検索する、regex_searchesと同じ
+      pos = (m.length() == 0) ? last_end + 1 : last_end;
+
+      if (flags & std::regex_constants::format_first_only) break;
+    }
+
+    if (copy) {
+      out = std::ranges::copy(input.substr(last_end), std::move(out)).out;
+    }
+    return out;
+  }
+
+  template<fixed_string Pattern, fixed_string Format>
+    requires std::same_as<typename decltype(Pattern)::char_type, typename decltype(Format)::char_type>
+  [[nodiscard]]
+  auto regex_replace(std::basic_string_view<typename decltype(Pattern)::char_type> input, std::regex_constants::match_flag_type flags = std::regex_constants::format_default) -> std::basic_string<typename decltype(Pattern)::char_type> {
+    std::basic_string<typename decltype(Pattern)::char_type> result;
+    result.reserve(input.size());
+    regex_replace<Pattern, Format>(std::back_inserter(result), input, flags);
+    return result;
+  }
+
+  namespace detail {
+
+    // ノードから生成されるThompson NFAの命令数の見積もり
+    template<typename Tree>
+    constexpr auto estimate_nfa_size(const Tree& tree, std::size_t index) -> std::size_t {
+      const auto& node = tree.nodes[index];
+
+      switch (node.kind) {
+      case node_kind::concatenation: [[fallthrough]];
+      case node_kind::alternation:
+      {
+        std::size_t size = 0;
+        for (auto c = node.child; c != syntax_node::npos; c = tree.nodes[c].sibling) {
+          size = length_add(size, estimate_nfa_size(tree, c));
+          // 選択肢ごとの分岐と合流
+          if (node.kind == node_kind::alternation and tree.nodes[c].sibling != syntax_node::npos) {
+            size = length_add(size, 2);
+          }
+        }
+        return size;
+      }
+      case node_kind::capture:
+        return length_add(estimate_nfa_size(tree, node.child), 2);
+      case node_kind::group:
+        return estimate_nfa_size(tree, node.child);
+      case node_kind::lookahead: [[fallthrough]];
+      case node_kind::negative_lookahead:
+        return length_add(estimate_nfa_size(tree, node.child), 1);
+      case node_kind::repeat:
+      {
+        // 本体にキャプチャがあれば、繰り返しごとにそれを未設定に戻す命令が付く
+        const auto [first, last] = capture_range(tree, node.child);
+        const auto body = length_add(estimate_nfa_size(tree, node.child), first < last ? 1 : 0);
+        const auto required = length_mul(body, node.first);
+
+        if (node.last == syntax_node::npos) {
+          return length_add(required, length_add(body, 2));
+        }
+        return length_add(required, length_mul(length_add(body, 1), node.last - node.first));
+      }
+      default:
+        return 1;
+      }
+    }
+  }
+
+  // コンパイル時に求めるパターンの性質
+  // std::match_resultsやバッファの事前確保、レビューでの高コストなパターンの判定に使う
+  struct pattern_info {
+    static constexpr std::size_t npos = syntax_node::npos;
+
+    std::size_t capture_group_count = 0;
+    // マッチの長さの範囲、上限が無ければnpos
+    std::size_t min_length = 0;
+    std::size_t max_length = 0;
+    // ^で始まる、$で終わる
+    bool anchored_begin = false;
+    bool anchored_end = false;
+    bool has_back_reference = false;
+    bool has_lookahead = false;
+    bool has_word_boundary = false;
+    // 破滅的なバックトラックを起こし得るか
+    bool backtracking_hazard = false;
+    // Thompson NFAの状態数の見積もり
+    std::size_t nfa_state_count = 0;
+
+    template<typename T>
+      requires std::convertible_to<const T&, std::string_view>
+    consteval pattern_info(const T& pattern) {
+      analyze(std::string_view(pattern));
+    }
+
+    template<typename T>
+      requires std::convertible_to<const T&, std::wstring_view>
+    consteval pattern_info(const T& pattern) {
+      analyze(std::wstring_view(pattern));
+    }
+
+    // std::match_resultsの部分マッチの数
+    constexpr auto submatch_count() const noexcept -> std::size_t {
+      return capture_group_count + 1;
+    }
+
+  private:
+    template<typename CharT>
+    consteval void analyze(std::basic_string_view<CharT> pattern) {
+      detail::dynamic_syntax_tree<CharT> tree{};
+      pattern_check<CharT>::parse(pattern, tree);
+
+      capture_group_count = tree.capture_group_count;
+      std::tie(min_length, max_length) = detail::length_bounds(tree, tree.root);
+      anchored_begin = detail::is_anchored(tree, tree.root, false);
+      anchored_end = detail::is_anchored(tree, tree.root, true);
+      backtracking_hazard = bool(detail::find_backtracking_hazard(tree));
+      // 末尾のmatch命令を含む
+      nfa_state_count = detail::length_add(detail::estimate_nfa_size(tree, tree.root), 1);
+
+      for (const auto& node : tree.nodes) {
+        has_back_reference = has_back_reference or node.kind == node_kind::back_reference;
+        has_lookahead = has_lookahead or node.kind == node_kind::lookahead or node.kind == node_kind::negative_lookahead;
+        has_word_boundary = has_word_boundary or node.kind == node_kind::word_boundary or node.kind == node_kind::not_word_boundary;
+      }
+    }
+  };
+
+  namespace detail {
+    // REGEX_PATTERN_ERRORのメッセージに対応するstd::regex_errorのエラーコード
+    inline auto pattern_error_code(std::string_view message) -> std::regex_constants::error_type {
+      using namespace std::regex_constants;
+
+      const auto contains = [message](std::string_view word) { return message.find(word) != std::string_view::npos; };
+
+      if (contains("backtracking")) return error_complexity;
+      if (contains("back reference")) return error_backref;
+      if (contains("Quantifiers braces")) return error_brace;
+      if (contains("Quantifier")) return error_badrepeat;
+      if (contains("character class")) return error_brack;
+      if (contains("escape") or contains("backslash")) return error_escape;
+      // 閉じていないグループ、対応しない閉じ括弧、誤った先読み
+      return error_paren;
+    }
+  }
+
+  // 実行時に与えられるパターンから構築したstd::basic_regexを共有するキャッシュ
+  // パターンごとにシャードを決め、シャードごとのロックとLRUで管理する
+  template<regex_usable_character CharT>
+  class basic_regex_cache {
+  public:
+    using regex_type = std::basic_regex<CharT>;
+    using flag_type = typename regex_type::flag_type;
+    using pointer = std::shared_ptr<const regex_type>;
+    using view_type = std::basic_string_view<CharT>;
+
+    struct statistics {
+      std::size_t hits = 0;
+      std::size_t misses = 0;
+      std::size_t evictions = 0;
+      std::size_t entries = 0;
+      // 保持しているstd::basic_regexのメモリ使用量の見積もり
+      std::size_t memory = 0;
+    };
+
+  private:
+    struct key_view {
+      view_type pattern;
+      flag_type flags;
+    };
+
+    struct key {
+      std::basic_string<CharT> pattern;
+      flag_type flags;
+
+      operator key_view() const noexcept {
+        return {pattern, flags};
+      }
+    };
+
+    struct key_hash {
+      auto operator()(const key_view& k) const noexcept -> std::size_t {
+        return std::hash<view_type>{}(k.pattern) ^ (std::size_t(k.flags) * 0x9E3779B97F4A7C15ull);
+      }
+    };
+
+    struct key_equal {
+      auto operator()(const key_view& lhs, const key_view& rhs) const noexcept -> bool {
+        return lhs.flags == rhs.flags and lhs.pattern == rhs.pattern;
+      }
+    };
+
+    struct entry {
+      key k;
+      pointer regex;
+      std::size_t cost;
+    };
+
+    struct shard {
+      mutable std::mutex mutex;
+      // 先頭が最も最近使われたもの
+      std::list<entry> lru;
+      // キーはlruの要素の文字列を参照する
+      std::unordered_map<key_view, typename std::list<entry>::iterator, key_hash, key_equal> index;
+      std::size_t memory = 0;
+      std::size_t hits = 0;
+      std::size_t misses = 0;
+      std::size_t evictions = 0;
+    };
+
+    std::size_t m_shard_budget;
+    std::unique_ptr<shard[]> m_shards;
+    std::size_t m_shard_count;
+
+    auto shard_of(const key_view& k) const -> shard& {
+      return m_shards[key_hash{}(k) % m_shard_count];
+    }
+
+    // ECMAScript以外の文法が指定されているか
+    static constexpr auto is_ecmascript(flag_type flags) -> bool {
+      using namespace std::regex_constants;
+      return (flags & (basic | extended | awk | grep | egrep)) == flag_type{};
+    }
+
+    // パターンをチェックし、構築するstd::basic_regexのメモリ使用量を見積もる
+    // 違反はstd::basic_regexの構築と同じくstd::regex_errorで報告する
+    static auto validate(view_type pattern, flag_type flags) -> std::size_t {
+      std::size_t states = 2 * pattern.size() + 1;
+
+      if (is_ecmascript(flags)) {
+        detail::dynamic_syntax_tree<CharT> tree{};
+        try {
+          pattern_check<CharT>::parse(pattern, tree);
+          if constexpr (detail::strict_backtracking) {
+            detail::check_backtracking(tree);
+          }
+        } catch (const char* message) {
+          throw std::regex_error(detail::pattern_error_code(message));
+        }
+        states = detail::estimate_nfa_size(tree, tree.root);
+      }
+
+      // NFAの1状態あたりの大きさは実装によるので、大きめに見積もる
+      return sizeof(regex_type) + sizeof(entry) + pattern.size() * sizeof(CharT) + detail::length_mul(states, 64);
+    }
+
+    // 予算を超えた分を古いものから捨てる、最新の1つは残す
+    void evict(shard& s) {
+      while (m_shard_budget < s.memory and 1 < s.lru.size()) {
+        auto& last = s.lru.back();
+        s.memory -= last.cost;
+        s.index.erase(last.k);
+        s.lru.pop_back();
+        ++s.evictions;
+      }
+    }
+
+  public:
+    // memory_budgetは全シャードの合計
+    explicit basic_regex_cache(std::size_t memory_budget = std::size_t(1) << 24, std::size_t shard_count = 16)
+      : m_shard_budget(memory_budget / std::max<std::size_t>(shard_count, 1))
+      , m_shards(std::make_unique<shard[]>(std::max<std::size_t>(shard_count, 1)))
+      , m_shard_count(std::max<std::size_t>(shard_count, 1))
+    {}
+
+    // パターンに対応するstd::basic_regexを返す、無ければ構築して保持する
+    // パターンがECMAScriptの文法に違反している場合はstd::regex_errorを投げる
+    // RIME_STRICT_BACKTRACKINGが定義されていれば、破滅的なバックトラックを起こし得るパターンもerror_complexityで拒否する
+    [[nodiscard]]
+    auto get(view_type pattern, flag_type flags = std::regex_constants::ECMAScript) -> pointer {
+      const key_view k{pattern, flags};
+      auto& s = shard_of(k);
+
+      {
+        std::lock_guard lock{s.mutex};
+
+        if (const auto it = s.index.find(k); it != s.index.end()) {
+          s.lru.splice(s.lru.begin(), s.lru, it->second);
+          ++s.hits;
+          return it->second->regex;
+        }
+        ++s.misses;
+      }
+
+      // 構築は重いので、ロックの外で行う
+      const auto cost = validate(pattern, flags);
+      auto regex = std::make_shared<const regex_type>(pattern.data(), pattern.size(), flags);
+
+      std::lock_guard lock{s.mutex};
+
+      // 他のスレッドが先に登録していればそちらを使う
+      if (const auto it = s.index.find(k); it != s.index.end()) {
+        s.lru.splice(s.lru.begin(), s.lru, it->second);
+        return it->second->regex;
+      }
+
+      s.lru.push_front(entry{key{std::basic_string<CharT>(pattern), flags}, std::move(regex), cost});
+      s.index.emplace(s.lru.front().k, s.lru.begin());
+      s.memory += cost;
+      evict(s);
+
+      return s.lru.front().regex;
+    }
+
+    [[nodiscard]]
+    auto stats() const -> statistics {
+      statistics result{};
+
+      for (std::size_t i = 0; i < m_shard_count; ++i) {
+        const auto& s = m_shards[i];
+        std::lock_guard lock{s.mutex};
+
+        result.hits += s.hits;
+        result.misses += s.misses;
+        result.evictions += s.evictions;
+        result.entries += s.lru.size();
+        result.memory += s.memory;
+      }
+
+      return result;
+    }
+
+    // 保持しているものを全て捨てる、既に返したものは使い続けられる
+    void clear() {
+      for (std::size_t i = 0; i < m_shard_count; ++i) {
+        auto& s = m_shards[i];
+        std::lock_guard lock{s.mutex};
+
+        s.index.clear();
+        s.lru.clear();
+        s.memory = 0;
+      }
+    }
+  };
+
+  using regex_cache = basic_regex_cache<char>;
+  using wregex_cache = basic_regex_cache<wchar_t>;
+
+  // 0からsize-1までの番号の集合（regex_setのマッチしたパターン、batch_matchのマッチした要素）
+  // 異なる64個ごとの区間は別のワードに入るので、別々のスレッドから同時にset()できる
+  class index_bitset {
+    std::size_t m_size = 0;
+    detail::constexpr_vector<std::uint64_t> m_words{};
+
+  public:
+    index_bitset() = default;
+
+    explicit index_bitset(std::size_t size)
+      : m_size(size)
+      , m_words((size + 63) / 64, 0)
+    {}
+
+    auto size() const noexcept -> std::size_t {
+      return m_size;
+    }
+
+    void set(std::size_t i) {
+      m_words[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    auto test(std::size_t i) const -> bool {
+      return i < m_size and ((m_words[i / 64] >> (i % 64)) & 1) != 0;
+    }
+
+    auto operator|=(const index_bitset& other) -> index_bitset& {
+      for (std::size_t i = 0; i < m_words.size(); ++i) {
+        m_words[i] |= other.m_words[i];
+      }
+      return *this;
+    }
+
+    auto count() const -> std::size_t {
+      std::size_t n = 0;
+      for (const auto w : m_words) n += std::size_t(std::popcount(w));
+      return n;
+    }
+
+    auto any() const -> bool {
+      return std::ranges::any_of(m_words, [](auto w) { return w != 0; });
+    }
+
+    auto none() const -> bool {
+      return not any();
+    }
+
+    auto all() const -> bool {
+      return count() == m_size;
+    }
+
+    // 含まれる番号を昇順に返す
+    auto indices() const {
+      return std::views::iota(std::size_t(0), m_size) | std::views::filter([this](std::size_t i) { return test(i); });
+    }
+
+    friend auto operator==(const index_bitset& lhs, const index_bitset& rhs) -> bool {
+      return lhs.m_size == rhs.m_size and lhs.m_words == rhs.m_words;
+    }
+  };
+
+  // 複数のパターンを1つのオートマトンにまとめ、入力の1回の走査でマッチする全てのパターンを求める
+  // 遷移は走査中に必要になったものだけを作って覚えておく（lazy DFA）ので、照合は入力長に比例する
+  // char（バイト単位）のパターンのみ、後方参照、先読み、\bと\Bは使えない
+  // matches()は遷移のキャッシュを更新するので、1つのオブジェクトを複数のスレッドから同時に使えない
+  class regex_set {
+  public:
+    // パターンの番号の集合
+    using bitset = index_bitset;
+
+  private:
+    static constexpr std::uint32_t unknown = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t npos = syntax_node::npos;
+
+    // DFAの状態はNFAの命令（consume, assert_end, match）の集合
+    struct state {
+      detail::constexpr_vector<std::size_t> pcs;
+      bitset matched;
+      bitset matched_at_end;
+      bool has_match = false;
+    };
+
+    std::size_t m_size = 0;
+    detail::nfa_program m_prog{};
+    // 各パターンの先頭の命令
+    detail::constexpr_vector<std::size_t> m_starts{};
+    // match命令のパターンの番号
+    detail::constexpr_vector<std::size_t> m_owner{};
+    std::array<std::size_t, 256> m_byte_class{};
+    std::size_t m_class_count = 0;
+    // 先頭以外の位置で始まるマッチの初期集合
+    detail::constexpr_vector<std::size_t> m_restart{};
+
+    std::size_t m_state_limit;
+    detail::constexpr_vector<state> m_states{};
+    // state * m_class_count + cls、未計算ならunknown
+    detail::constexpr_vector<std::uint32_t> m_next{};
+    std::unordered_map<std::string, std::uint32_t> m_index{};
+    std::uint32_t m_start = unknown;
+
+    void add_pattern(std::string_view pattern) {
+      detail::dynamic_syntax_tree<char> tree{};
+      pattern_check<char>::parse(pattern, tree);
+
+      const auto prog = detail::compile_nfa(tree);
+      const auto offset = m_prog.insts.size();
+
+      if (detail::nfa_size_limit <= offset + prog.insts.size()) {
+        REGEX_PATTERN_ERROR("The patterns are too large to build an automaton.");
+      }
+
+      m_starts.push_back(offset);
+
+      for (auto inst : prog.insts) {
+        switch (inst.op) {
+        case detail::nfa_op::consume:
+        {
+          const auto n = char_to_num(m_prog.sets, prog.sets[inst.x]);
+          if (n == m_prog.sets.size()) m_prog.sets.push_back(prog.sets[inst.x]);
+          inst.x = n;
+          break;
+        }
+        case detail::nfa_op::split:
+          inst.x += offset;
+          inst.y += offset;
+          break;
+        case detail::nfa_op::jump:
+          inst.x += offset;
+          break;
+        case detail::nfa_op::assert_word_boundary: [[fallthrough]];
+        case detail::nfa_op::assert_not_word_boundary:
+          REGEX_PATTERN_ERROR("Word boundaries cannot be converted to a DFA.");
+        default:
+          break;
+        }
+
+        m_prog.insts.push_back(inst);
+        m_owner.push_back(inst.op == detail::nfa_op::match ? m_size : npos);
+      }
+
+      ++m_size;
+    }
+
+    void build_byte_classes() {
+      // どの集合にも同じように振り分けられるバイトを同値類にまとめる
+      for (const auto& set : m_prog.sets) {
+        detail::constexpr_vector<std::size_t> renumber(2 * 256, npos);
+        std::size_t count = 0;
+
+        for (std::size_t c = 0; c < 256; ++c) {
+          auto& id = renumber[2 * m_byte_class[c] + (set.test(c) ? 1 : 0)];
+          if (id == npos) id = count++;
+          m_byte_class[c] = id;
+        }
+      }
+      m_class_count = *std::ranges::max_element(m_byte_class) + 1;
+    }
+
+    auto closure_of(const detail::constexpr_vector<std::size_t>& pcs, bool at_begin, bool at_end) const -> detail::constexpr_vector<std::size_t> {
+      detail::constexpr_vector<std::size_t> out;
+      detail::constexpr_vector<unsigned char> visited(m_prog.insts.size(), false);
+
+      for (const auto pc : pcs) {
+        detail::nfa_closure(m_prog, pc, at_begin, at_end, out, visited);
+      }
+      std::ranges::sort(out);
+      return out;
+    }
+
+    auto state_of(detail::constexpr_vector<std::size_t>&& pcs) -> std::uint32_t {
+      std::string key(reinterpret_cast<const char*>(pcs.data()), pcs.size() * sizeof(std::size_t));
+
+      if (const auto it = m_index.find(key); it != m_index.end()) {
+        return it->second;
+      }
+
+      if (m_state_limit <= m_states.size()) {
+        // キャッシュを捨てて作り直す
+        m_states.clear();
+        m_next.clear();
+        m_index.clear();
+        m_start = unknown;
+      }
+
+      state s{std::move(pcs), bitset(m_size), bitset(m_size)};
+      detail::constexpr_vector<std::size_t> ends;
+
+      for (const auto pc : s.pcs) {
+        if (m_prog.insts[pc].op == detail::nfa_op::match) {
+          s.matched.set(m_owner[pc]);
+          s.has_match = true;
+        } else if (m_prog.insts[pc].op == detail::nfa_op::assert_end) {
+          ends.push_back(pc + 1);
+        }
+      }
+
+      s.matched_at_end = s.matched;
+      for (const auto pc : closure_of(ends, false, true)) {
+        if (m_prog.insts[pc].op == detail::nfa_op::match) s.matched_at_end.set(m_owner[pc]);
+      }
+
+      const auto index = std::uint32_t(m_states.size());
+      m_states.push_back(std::move(s));
+      m_next.resize(m_next.size() + m_class_count, unknown);
+      m_index.emplace(std::move(key), index);
+
+      return index;
+    }
+
+    auto start_state() -> std::uint32_t {
+      if (m_start == unknown) {
+        m_start = state_of(closure_of(m_starts, true, false));
+      }
+      return m_start;
+    }
+
+    auto next_state(std::uint32_t s, std::size_t cls) -> std::uint32_t {
+      if (const auto n = m_next[s * m_class_count + cls]; n != unknown) {
+        return n;
+      }
+
+      const auto c = char_to_num(m_byte_class, cls);
+      detail::constexpr_vector<std::size_t> targets = m_restart;
+
+      for (const auto pc : m_states[s].pcs) {
+        const auto& inst = m_prog.insts[pc];
+        if (inst.op == detail::nfa_op::consume and m_prog.sets[inst.x].test(c)) {
+          targets.push_back(pc + 1);
+        }
+      }
+
+      const auto cache_size = m_states.size();
+      const auto n = state_of(closure_of(targets, false, false));
+
+      // キャッシュを作り直した場合は元の状態が消えている
+      if (cache_size <= m_states.size() and s < m_states.size()) {
+        m_next[s * m_class_count + cls] = n;
+      }
+      return n;
+    }
+
+  public:
+    // state_limitはキャッシュするDFAの状態数の上限
+    template<std::ranges::input_range R>
+      requires std::convertible_to<std::ranges::range_reference_t<R>, std::string_view>
+    explicit regex_set(const R& patterns, std::size_t state_limit = detail::dfa_state_limit)
+      : m_state_limit(std::max<std::size_t>(state_limit, 2))
+    {
+      for (std::string_view pattern : patterns) {
+        add_pattern(pattern);
+      }
+      build_byte_classes();
+      m_restart = closure_of(m_starts, false, false);
+    }
+
+    regex_set(std::initializer_list<std::string_view> patterns, std::size_t state_limit = detail::dfa_state_limit)
+      : regex_set(std::ranges::subrange(patterns.begin(), patterns.end()), state_limit)
+    {}
+
+    // パターンの数
+    auto size() const noexcept -> std::size_t {
+      return m_size;
+    }
+
+    // inputのどこかにマッチするパターンの集合
+    [[nodiscard]]
+    auto matches(std::string_view input) -> bitset {
+      bitset result(m_size);
+
+      auto s = start_state();
+      if (m_states[s].has_match) result |= m_states[s].matched;
+
+      for (std::size_t i = 0; i < input.size(); ++i) {
+        s = next_state(s, m_byte_class[static_cast<unsigned char>(input[i])]);
+
+        if (m_states[s].has_match) {
+          result |= m_states[s].matched;
+          if (result.all()) return result;
+        }
+        // 全てのパターンが先頭に固定されていて、どのスレッドも残っていない
+        if (m_states[s].pcs.empty()) return result;
+      }
+
+      result |= m_states[s].matched_at_end;
+      return result;
+    }
+
+    // いずれかのパターンにマッチするか
+    [[nodiscard]]
+    auto is_match(std::string_view input) -> bool {
+      auto s = start_state();
+
+      for (std::size_t i = 0; not m_states[s].has_match; ++i) {
+        if (i == input.size()) {
+          return m_states[s].matched_at_end.any();
+        }
+        if (m_states[s].pcs.empty()) return false;
+        s = next_state(s, m_byte_class[static_cast<unsigned char>(input[i])]);
+      }
+      return true;
+    }
+
+    // キャッシュしているDFAの状態数
+    auto cached_states() const noexcept -> std::size_t {
+      return m_states.size();
+    }
+  };
+
+  // parallel_regex_searchesの分割の指定
+  struct parallel_policy {
+    // 0ならstd::thread::hardware_concurrency()
+    std::size_t threads = 0;
+    // 1つのタスクが受け持つ、マッチの開始位置の範囲の長さ
+    std::size_t chunk_size = std::size_t(1) << 20;
+    // レコードの区切りの文字、指定すると各レコードを独立した入力として検索する
+    // マッチはレコードを跨がず、^と$はレコードの先頭と末尾にマッチする
+    std::optional<char32_t> record_delimiter{};
+  };
+
+  namespace detail {
+
+    // 先読みを含むか、先読みはマッチの終わりより後ろを読むので、マッチの長さだけでは読む範囲が決まらない
+    template<typename Tree>
+    constexpr auto has_lookahead(const Tree& tree) -> bool {
+      for (const auto& node : tree.nodes) {
+        if (node.kind == node_kind::lookahead or node.kind == node_kind::negative_lookahead) {
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // チャンクの終わりより前で始まるマッチを探すのに必要な、チャンクの後ろの文字数
+    // マッチの長さに上限が無い、あるいは先読みや後方参照がある場合はnpos（入力の末尾まで）
+    template<typename Tree>
+    constexpr auto search_overlap(const Tree& tree) -> std::size_t {
+      if (has_lookahead(tree)) {
+        return syntax_node::npos;
+      }
+      for (const auto& node : tree.nodes) {
+        if (node.kind == node_kind::back_reference) {
+          return syntax_node::npos;
+        }
+      }
+      // \bと\Bがマッチの直後の1文字を見る
+      return length_add(length_bounds(tree, tree.root).second, 1);
+    }
+
+    // 1つのチャンクの検索結果
+    template<typename Match>
+    struct chunk_matches {
+      std::vector<Match> matches;
+      // 最後に検索を始めた位置、ここからチャンクの終わりまでに始まるマッチは無い
+      std::size_t tail = 0;
+    };
+
+    // 逐次的な検索で、mの次に検索を始める位置
+    template<typename Match>
+    constexpr auto next_origin(const Match& m) -> std::size_t {
+      return m.end_position() + (m.length() == 0 ? 1 : 0);
+    }
+
+    // 入力のoffsetから始まる部分に対するマッチを、元の入力を参照するマッチにする
+    template<typename Match>
+    constexpr auto rebase(const Match& m, typename Match::view_type input, std::size_t offset = 0) -> Match {
+      auto groups = Match::unmatched_groups();
+      for (std::size_t i = 0; i < groups.size(); ++i) {
+        if (m.matched(i)) {
+          groups[i] = {m.position(i) + offset, m.end_position(i) + offset};
+        }
+      }
+      return {input, groups};
+    }
+
+    // 入力をレコードの区切りで分け、各レコードを独立した入力として並列に検索する
+    // チャンクの境界はレコードの区切りの直後まで後ろにずらすので、レコードがチャンクを跨ぐことは無い
+    template<regex_searcher E>
+    auto parallel_record_searches(std::basic_string_view<typename E::char_type> input, const E& engine, const parallel_policy& policy) -> std::vector<typename E::match_type> {
+      using char_type = typename E::char_type;
+      using match_type = typename E::match_type;
+      using traits = std::char_traits<char_type>;
+
+      const auto delimiter = static_cast<char_type>(*policy.record_delimiter);
+      const auto chunk_size = std::max<std::size_t>(policy.chunk_size, 1);
+      const auto chunk_count = (input.size() + chunk_size - 1) / chunk_size;
+
+      // k番目のチャンクの先頭、k * chunk_sizeの1文字前から次の区切りを探し、その直後にする
+      auto boundary = [&](std::size_t k) -> std::size_t {
+        if (k == 0) return 0;
+        if (k == chunk_count) return input.size();
+        const auto from = k * chunk_size - 1;
+        const auto* hit = traits::find(input.data() + from, input.size() - from, delimiter);
+        return (hit == nullptr) ? input.size() : std::size_t(hit - input.data()) + 1;
+      };
+
+      std::vector<std::vector<match_type>> chunks(chunk_count);
+
+      detail::parallel_for(chunk_count, policy.threads, [&](std::size_t k, std::size_t) {
+        const auto last = boundary(k + 1);
+        auto& matches = chunks[k];
+
+        // 最後の区切りの後に何も無ければ、そこはレコードとして数えない
+        for (auto first = boundary(k); first < last;) {
+          const auto* hit = traits::find(input.data() + first, last - first, delimiter);
+          const auto end = (hit == nullptr) ? last : std::size_t(hit - input.data());
+          const auto record = input.substr(first, end - first);
+
+          for (std::size_t origin = 0; origin <= record.size();) {
+            const auto m = engine.search(record, origin);
+            if (not m) break;
+            matches.push_back(detail::rebase(m, input, first));
+            origin = detail::next_origin(m);
+          }
+          first = end + 1;
+        }
+      });
+
+      std::vector<match_type> result;
+      for (auto& matches : chunks) {
+        result.insert(result.end(), matches.begin(), matches.end());
+      }
+      return result;
+    }
+  }
+
+  // parallel_regex_searchesがrecord_delimiter無しでも入力をチャンクに分けて並列に検索するか
+  // falseのパターン（マッチの長さに上限が無い、先読みや後方参照がある）は、record_delimiterが無ければ逐次的に検索する
+  template<regex_searcher E>
+    requires requires { E::tree; }
+  inline constexpr bool parallel_splittable = detail::search_overlap(E::tree) != syntax_node::npos;
+
+  // regex_searchesと同じマッチの列を、入力をチャンクに分けて複数のスレッドで求める
+  // 各チャンクはそのチャンクで始まるマッチを担当し、マッチの最大長（search_overlap）だけ後ろを見て検索する
+  // チャンクを跨ぐマッチで検索の開始位置がずれた場合は、結合時に逐次的な検索で同期し直す
+  // マッチの長さに上限が無いパターンは、record_delimiterが無ければチャンクに分けずに逐次的に検索する
+  template<regex_searcher E>
+    requires requires { E::tree; }
+  [[nodiscard]]
+  auto parallel_regex_searches(std::basic_string_view<typename E::char_type> input, const E& engine, parallel_policy policy = {}) -> std::vector<typename E::match_type> {
+    using match_type = typename E::match_type;
+    using view_type = std::basic_string_view<typename E::char_type>;
+
+    if (policy.record_delimiter) {
+      return detail::parallel_record_searches(input, engine, policy);
+    }
+
+    static constexpr auto overlap = detail::search_overlap(E::tree);
+
+    // 検索は窓の末尾までの全ての位置を開始位置として試すので、窓が入力の末尾まで伸びると
+    // チャンクごとに入力全体を走査することになり、逐次的な検索より遅くなる
+    if constexpr (overlap == syntax_node::npos) {
+      std::vector<match_type> result;
+      for (const auto& m : regex_searches(input, engine)) {
+        result.push_back(m);
+      }
+      return result;
+    }
+
+    const auto chunk_size = std::max<std::size_t>(policy.chunk_size, 1);
+    // 末尾の空のマッチも最後のチャンクが受け持つ
+    const auto chunk_count = input.size() / chunk_size + 1;
+
+    auto chunk_first = [&](std::size_t k) { return k * chunk_size; };
+    auto chunk_last = [&](std::size_t k) { return (k + 1 == chunk_count) ? input.size() + 1 : (k + 1) * chunk_size; };
+    auto window = [&](std::size_t k) -> view_type {
+      return input.substr(0, detail::length_add(chunk_last(k), overlap));
+    };
+
+    std::vector<detail::chunk_matches<match_type>> chunks(chunk_count);
+
+    auto search_chunk = [&](std::size_t k) {
+      const auto last = chunk_last(k);
+      const auto w = window(k);
+      auto& chunk = chunks[k];
+
+      auto origin = chunk_first(k);
+      while (origin < last and origin <= input.size()) {
+        const auto m = engine.search(w, origin);
+        if (not m or last <= m.position()) break;
+
+        chunk.matches.push_back(detail::rebase(m, input));
+        origin = detail::next_origin(m);
+      }
+      chunk.tail = origin;
+    };
+
+    detail::parallel_for(chunk_count, policy.threads, [&](std::size_t k, std::size_t) {
+      search_chunk(k);
+    });
+
+    // 逐次的な検索の開始位置posを追いながら、各チャンクの結果を繋ぐ
+    // マッチの有無とその内容は開始位置にだけ依存するので、posから始まる検索の列がチャンクの検索の列と合流した後はそれを使える
+    std::vector<match_type> result;
+    std::size_t pos = 0;
+
+    for (std::size_t k = 0; k < chunk_count and pos <= input.size(); ++k) {
+      const auto& chunk = chunks[k];
+      const auto last = chunk_last(k);
+
+      while (pos < last) {
+        const auto it = std::ranges::lower_bound(chunk.matches, pos, {}, [](const match_type& m) { return m.position(); });
+        const auto j = std::size_t(it - chunk.matches.begin());
+        const auto origin = (j == 0) ? chunk_first(k) : detail::next_origin(chunk.matches[j - 1]);
+
+        if (origin <= pos) {
+          result.insert(result.end(), it, chunk.matches.end());
+          pos = std::max(pos, chunk.tail);
+          break;
+        }
+
+        // 直前のマッチがこのチャンクに食い込み、検索の開始位置がずれている
+        const auto m = engine.search(window(k), pos);
+        if (not m or last <= m.position()) break;
+
+        result.push_back(detail::rebase(m, input));
+        pos = detail::next_origin(m);
+      }
+
+      // チャンクの残りで始まるマッチは無い
+      pos = std::max(pos, last);
+    }
+
+    return result;
+  }
+
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto parallel_regex_searches(std::basic_string_view<typename decltype(Pattern)::char_type> input, parallel_policy policy = {}) {
+    return parallel_regex_searches(input, detail::shared_engine<Pattern>(), policy);
+  }
+
+  // batch_match、batch_searchの分割の指定
+  struct batch_policy {
+    // 0ならstd::thread::hardware_concurrency()
+    std::size_t threads = 0;
+    // 1つのタスクが受け持つ要素の数、64の倍数に切り上げる
+    std::size_t block_size = 4096;
+  };
+
+  namespace detail {
+    // 要素の範囲と、1つの要素を調べる関数
+    template<typename E, typename R>
+    concept batch_input = std::ranges::random_access_range<R> and std::ranges::sized_range<R> and std::convertible_to<std::ranges::range_reference_t<R>, std::basic_string_view<typename E::char_type>>;
+
+    // test(engine, str, scratch)がtrueになる要素の番号の集合を、スレッドごとの作業領域を使って求める
+    // ブロックは64の倍数の要素からなるので、各スレッドは結果の別々のワードに書き込む
+    template<typename E, typename R, typename Test>
+    auto batch_run(R&& records, const E& engine, batch_policy policy, Test test) -> index_bitset {
+      using view_type = std::basic_string_view<typename E::char_type>;
+
+      const auto size = std::size_t(std::ranges::size(records));
+      const auto block_size = std::max<std::size_t>((policy.block_size + 63) / 64 * 64, 64);
+      const auto block_count = (size + block_size - 1) / block_size;
+
+      index_bitset result(size);
+      std::vector<typename scratch_of<E>::type> scratch(parallel_worker_count(block_count, policy.threads));
+      const auto first = std::ranges::begin(records);
+
+      parallel_for(block_count, policy.threads, [&](std::size_t k, std::size_t worker) {
+        auto& s = scratch[worker];
+        const auto last = std::min(size, (k + 1) * block_size);
+
+        for (auto i = k * block_size; i < last; ++i) {
+          if (test(engine, view_type(first[std::ranges::range_difference_t<R>(i)]), s)) {
+            result.set(i);
+          }
+        }
+      });
+
+      return result;
+    }
+  }
+
+  // recordsの各要素の全体がパターンにマッチするかを、複数のスレッドで調べる
+  // 戻り値はマッチした要素の番号の集合
+  template<typename E, typename R>
+    requires detail::batch_input<E, R> and requires(const E& e, std::basic_string_view<typename E::char_type> str) { bool(e.match(str)); }
+  [[nodiscard]]
+  auto batch_match(R&& records, const E& engine, batch_policy policy = {}) -> index_bitset {
+    return detail::batch_run(records, engine, policy, [](const E& e, auto str, auto& scratch) -> bool {
+      if constexpr (requires { e.match(str, scratch); }) {
+        return bool(e.match(str, scratch));
+      } else {
+        return bool(e.match(str));
+      }
+    });
+  }
+
+  // recordsの各要素にパターンにマッチする部分があるかを、複数のスレッドで調べる
+  template<typename E, typename R>
+    requires detail::batch_input<E, R> and requires(const E& e, std::basic_string_view<typename E::char_type> str) { bool(e.search(str)); }
+  [[nodiscard]]
+  auto batch_search(R&& records, const E& engine, batch_policy policy = {}) -> index_bitset {
+    return detail::batch_run(records, engine, policy, [](const E& e, auto str, auto& scratch) -> bool {
+      if constexpr (requires { e.search(str, 0, scratch); }) {
+        return bool(e.search(str, 0, scratch));
+      } else {
+        return bool(e.search(str));
+      }
+    });
+  }
+
+  namespace detail {
+    // std::regexの作業領域はstd::match_results
+    template<typename CharT, typename Traits>
+    struct batch_regex {
+      using char_type = CharT;
+      using scratch_type = std::match_results<const CharT*>;
+
+      const std::basic_regex<CharT, Traits>* re;
+
+      auto match(std::basic_string_view<CharT> str, scratch_type& m) const -> bool {
+        return std::regex_match(str.data(), str.data() + str.size(), m, *re);
+      }
+
+      auto search(std::basic_string_view<CharT> str, std::size_t, scratch_type& m) const -> bool {
+        return std::regex_search(str.data(), str.data() + str.size(), m, *re);
+      }
+
+      auto match(std::basic_string_view<CharT> str) const -> bool {
+        scratch_type m;
+        return match(str, m);
+      }
+
+      auto search(std::basic_string_view<CharT> str) const -> bool {
+        scratch_type m;
+        return search(str, 0, m);
+      }
+    };
+
+    template<typename CharT, typename Traits>
+    struct scratch_of<batch_regex<CharT, Traits>> {
+      using type = std::match_results<const CharT*>;
+    };
+  }
+
+  template<typename R, regex_usable_character CharT, typename Traits>
+    requires detail::batch_input<detail::batch_regex<CharT, Traits>, R>
+  [[nodiscard]]
+  auto batch_match(R&& records, const std::basic_regex<CharT, Traits>& re, batch_policy policy = {}) -> index_bitset {
+    return batch_match(records, detail::batch_regex<CharT, Traits>{std::addressof(re)}, policy);
+  }
+
+  template<typename R, regex_usable_character CharT, typename Traits>
+    requires detail::batch_input<detail::batch_regex<CharT, Traits>, R>
+  [[nodiscard]]
+  auto batch_search(R&& records, const std::basic_regex<CharT, Traits>& re, batch_policy policy = {}) -> index_bitset {
+    return batch_search(records, detail::batch_regex<CharT, Traits>{std::addressof(re)}, policy);
+  }
+
+  template<fixed_string Pattern, typename R>
+  [[nodiscard]]
+  auto batch_match(R&& records, batch_policy policy = {}) -> index_bitset {
+    return batch_match(records, detail::shared_engine<Pattern>(), policy);
+  }
+
+  template<fixed_string Pattern, typename R>
+  [[nodiscard]]
+  auto batch_search(R&& records, batch_policy policy = {}) -> index_bitset {
+    return batch_search(records, detail::shared_engine<Pattern>(), policy);
+  }
+
+  // 少しずつ届く入力（ソケットやパイプ）を、全体を保持せずに検索する
+  // feed()で渡された断片を繋げて、regex_searchesで入力全体を検索した場合と同じマッチを順にコールバックに渡す
+  // 保持するのは、まだ結果が確定していない末尾だけ（マッチの最大長+2文字程度）
+  // マッチの長さに上限が無いパターンは、max_lengthを指定しなければ最初の候補位置から後をfinish()まで保持する
+  // 先読みを含むパターンは、max_lengthによらずfinish()まで保持する
+  template<regex_searcher E>
+    requires requires { E::tree; }
+  class stream_searcher {
+  public:
+    using char_type = typename E::char_type;
+    using view_type = std::basic_string_view<char_type>;
+    using match_type = typename E::match_type;
+
+  private:
+    static constexpr std::size_t npos = syntax_node::npos;
+    static constexpr auto starts = detail::make_start_filter(E::tree);
+
+    E m_engine;
+    // マッチの開始位置からこの文字数が揃えば、そのマッチは後続の入力に左右されない
+    std::size_t m_overlap;
+    std::basic_string<char_type, std::char_traits<char_type>, std::pmr::polymorphic_allocator<char_type>> m_buffer;
+    [[no_unique_address]] typename detail::scratch_of<E>::type m_scratch{};
+    // m_buffer[0]の、ストリーム全体での位置
+    std::size_t m_base = 0;
+    // 次に検索を始める位置（ストリーム全体での位置）
+    std::size_t m_origin = 0;
+    std::size_t m_consumed = 0;
+    // 入力の終わりが伝えられた
+    bool m_closed = false;
+
+    // この位置より前で始まるマッチは確定できる（m_buffer上の位置）
+    auto safe_limit() const -> std::size_t {
+      if (m_closed) return m_buffer.size() + 1;
+      return (m_overlap == npos or m_buffer.size() + 1 < m_overlap) ? 0 : m_buffer.size() + 1 - m_overlap;
+    }
+
+    static auto make_scratch(std::pmr::memory_resource* resource) -> typename detail::scratch_of<E>::type {
+      if constexpr (std::constructible_from<typename detail::scratch_of<E>::type, std::pmr::memory_resource*>) {
+        return typename detail::scratch_of<E>::type(resource);
+      } else {
+        return {};
+      }
+    }
+
+    auto search(view_type buffer, std::size_t from) -> match_type {
+      if constexpr (scratch_regex_searcher<E>) {
+        return m_engine.search(buffer, from, m_scratch);
+      } else {
+        return m_engine.search(buffer, from);
+      }
+    }
+
+    // 確定したマッチを返した後の、もう検索に使わない先頭部分を捨てる
+    void compact() {
+      if (m_closed) return;
+
+      const view_type buffer = m_buffer;
+      auto origin = m_origin - m_base;
+
+      // 開始位置になり得ない文字は読み飛ばせる
+      if (origin < buffer.size()) {
+        origin = std::min(starts.next(buffer, origin), buffer.size());
+      }
+
+      // \bの判定と、先頭（^）でないことを示すために1文字前から残す
+      const auto drop = (0 < origin) ? origin - 1 : 0;
+      m_buffer.erase(0, drop);
+      m_base += drop;
+      m_origin = m_base + (origin - drop);
+    }
+
+  public:
+    // max_lengthはマッチの長さに上限が無いパターンに対して、利用者が保証する上限
+    // 先読みはマッチの後ろを読むので、先読みを含むパターンではmax_lengthを使わずfinish()まで保持する
+    // バッファとエンジンの作業領域はresourceから確保する、断片の長さが一定なら確保は最初の数回だけ
+    explicit stream_searcher(E engine = E{}, std::size_t max_length = npos, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : m_engine(std::move(engine))
+      , m_overlap(detail::search_overlap(E::tree))
+      , m_buffer(resource)
+      , m_scratch(make_scratch(resource))
+    {
+      if (m_overlap == npos and max_length != npos and not detail::has_lookahead(E::tree)) {
+        m_overlap = max_length + 1;
+      }
+    }
+
+    // 入力の断片を追加する、以前にnext()で受け取ったマッチは無効になる
+    void push(view_type chunk) {
+      assert(not m_closed);
+      compact();
+      m_buffer.append(chunk);
+      m_consumed += chunk.size();
+    }
+
+    // 入力の終わりを伝える、以降のnext()は残りのマッチを全て返す
+    void close() {
+      m_closed = true;
+    }
+
+    // 次の確定したマッチ、まだ無ければ空の結果
+    // マッチは内部バッファを参照し、ストリーム全体での位置はoffset() + m.position(i)
+    [[nodiscard]]
+    auto next() -> match_type {
+      const view_type buffer = m_buffer;
+      const auto limit = safe_limit();
+      const auto origin = m_origin - m_base;
+
+      if (limit <= origin or buffer.size() < origin) return {};
+
+      const auto m = search(buffer, origin);
+      if (not m or limit <= m.position()) {
+        // 確定できる範囲にマッチは無い
+        m_origin = m_base + limit;
+        return {};
+      }
+
+      m_origin = m_base + detail::next_origin(m);
+      return m;
+    }
+
+    // 内部バッファの先頭の、ストリーム全体での位置
+    auto offset() const noexcept -> std::size_t {
+      return m_base;
+    }
+
+    // 入力の断片を追加し、確定したマッチをon_match(m, offset)に渡す
+    // mはこのオブジェクトの内部バッファを参照し、ストリーム全体での位置はoffset + m.position(i)
+    template<typename F>
+    void feed(view_type chunk, F&& on_match) {
+      push(chunk);
+      while (const auto m = next()) {
+        on_match(m, m_base);
+      }
+      compact();
+    }
+
+    // 入力の終わりを伝え、残りのマッチを渡す、その後は新しいストリームとして使える
+    template<typename F>
+    void finish(F&& on_match) {
+      close();
+      while (const auto m = next()) {
+        on_match(m, m_base);
+      }
+      reset();
+    }
+
+    // 新しいストリームを始める
+    void reset() {
+      m_buffer.clear();
+      m_base = 0;
+      m_origin = 0;
+      m_consumed = 0;
+      m_closed = false;
+    }
+
+    // これまでに渡された文字数
+    auto consumed() const noexcept -> std::size_t {
+      return m_consumed;
+    }
+
+    // 保持している文字数
+    auto buffered() const noexcept -> std::size_t {
+      return m_buffer.size();
+    }
+  };
+
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto make_stream_searcher(std::size_t max_length = syntax_node::npos) {
+    using engine_type = std::remove_cvref_t<decltype(regex<Pattern>())>;
+    return stream_searcher<engine_type>{detail::shared_engine<Pattern>(), max_length};
+  }
+
+  // co_yieldされた値を1つずつ取り出すinput_range
+  // 値はコピーされず、イテレータを進めるまで有効
+  template<typename T>
+  class generator : public std::ranges::view_interface<generator<T>> {
+  public:
+    struct promise_type {
+      const T* value = nullptr;
+      std::exception_ptr error{};
+
+      auto get_return_object() -> generator {
+        return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+
+      auto initial_suspend() noexcept -> std::suspend_always {
+        return {};
+      }
+
+      auto final_suspend() noexcept -> std::suspend_always {
+        return {};
+      }
+
+      // 一時オブジェクトもco_yieldの式が終わる（再開される）まで生存する
+      auto yield_value(const T& v) noexcept -> std::suspend_always {
+        value = std::addressof(v);
+        return {};
+      }
+
+      void return_void() noexcept {}
+
+      void unhandled_exception() {
+        error = std::current_exception();
+      }
+    };
+
+  private:
+    std::coroutine_handle<promise_type> m_handle{};
+
+    explicit generator(std::coroutine_handle<promise_type> handle)
+      : m_handle(handle)
+    {}
+
+    // 次のco_yieldまで進める、コルーチンの中で投げられた例外はここから投げ直す
+    void resume() {
+      m_handle.resume();
+      if (m_handle.done() and m_handle.promise().error) {
+        std::rethrow_exception(std::exchange(m_handle.promise().error, nullptr));
+      }
+    }
+
+    class iterator {
+      generator* m_parent = nullptr;
+
+      auto done() const -> bool {
+        return m_parent->m_handle.done();
+      }
+
+    public:
+      using iterator_concept = std::input_iterator_tag;
+      using value_type = T;
+      using difference_type = std::ptrdiff_t;
+
+      iterator() = default;
+
+      explicit iterator(generator* parent)
+        : m_parent(parent)
+      {}
+
+      auto operator*() const -> const T& {
+        return *m_parent->m_handle.promise().value;
+      }
+
+      auto operator++() -> iterator& {
+        m_parent->resume();
+        return *this;
+      }
+
+      void operator++(int) {
+        ++*this;
+      }
+
+      friend auto operator==(const iterator& it, std::default_sentinel_t) -> bool {
+        return it.done();
+      }
+    };
+
+  public:
+    generator(generator&& other) noexcept
+      : m_handle(std::exchange(other.m_handle, nullptr))
+    {}
+
+    auto operator=(generator&& other) noexcept -> generator& {
+      if (this != &other) {
+        if (m_handle) m_handle.destroy();
+        m_handle = std::exchange(other.m_handle, nullptr);
+      }
+      return *this;
+    }
+
+    ~generator() {
+      if (m_handle) m_handle.destroy();
+    }
+
+    // 1度だけ呼び出せる
+    auto begin() -> iterator {
+      resume();
+      return iterator{this};
+    }
+
+    auto end() const noexcept -> std::default_sentinel_t {
+      return std::default_sentinel;
+    }
+  };
+
+  // regex_match_streamが返すマッチ
+  template<typename Match>
+  struct stream_match {
+    // 内部バッファを参照するので、次のマッチを取り出すまで有効
+    Match match;
+    // match.position(i)に足すと、ストリーム全体での位置になる
+    std::size_t offset = 0;
+
+    auto position(std::size_t i = 0) const -> std::size_t {
+      return offset + match.position(i);
+    }
+
+    auto length(std::size_t i = 0) const -> std::size_t {
+      return match.length(i);
+    }
+
+    auto str(std::size_t i = 0) const {
+      return match.str(i);
+    }
+  };
+
+  // reader()が返す断片（空なら入力の終わり）を必要になった時に読み、確定したマッチを順にco_yieldする
+  // 利用者が次のマッチを求めるまでreader()は呼ばれないので、入力全体や結果の列を保持しない
+  template<regex_searcher E, typename Reader>
+    requires requires { E::tree; } and std::convertible_to<std::invoke_result_t<Reader&>, std::basic_string_view<typename E::char_type>>
+  [[nodiscard]]
+  auto regex_match_stream(Reader reader, E engine = E{}, std::size_t max_length = syntax_node::npos) -> generator<stream_match<typename E::match_type>> {
+    stream_searcher<E> searcher{std::move(engine), max_length};
+
+    while (true) {
+      const std::basic_string_view<typename E::char_type> chunk = reader();
+      if (chunk.empty()) break;
+
+      searcher.push(chunk);
+      while (const auto m = searcher.next()) {
+        co_yield stream_match<typename E::match_type>{m, searcher.offset()};
+      }
+    }
+
+    searcher.close();
+    while (const auto m = searcher.next()) {
+      co_yield stream_match<typename E::match_type>{m, searcher.offset()};
+    }
+  }
+
+  // inからchunk_size文字ずつ読む、inは戻り値のgeneratorより長く生存している必要がある
+  template<regex_searcher E>
+    requires requires { E::tree; }
+  [[nodiscard]]
+  auto regex_match_stream(std::basic_istream<typename E::char_type>& in, E engine = E{}, std::size_t max_length = syntax_node::npos, std::size_t chunk_size = std::size_t(1) << 16) -> generator<stream_match<typename E::match_type>> {
+    using char_type = typename E::char_type;
+
+    auto reader = [&in, buffer = std::basic_string<char_type>(std::max<std::size_t>(chunk_size, 1), char_type{})]() mutable -> std::basic_string_view<char_type> {
+      in.read(buffer.data(), std::streamsize(buffer.size()));
+      return {buffer.data(), std::size_t(in.gcount())};
+    };
+    return regex_match_stream(std::move(reader), std::move(engine), max_length);
+  }
+
+  template<fixed_string Pattern, typename Source>
+  [[nodiscard]]
+  auto regex_match_stream(Source&& source, std::size_t max_length = syntax_node::npos) {
+    return regex_match_stream(std::forward<Source>(source), detail::shared_engine<Pattern>(), max_length);
+  }
+}
+
+namespace rime::detail {
+
+  // [first, last)の改行の数と、最後の改行の位置（無ければnullptr）
+  template<typename CharT>
+  struct newline_scan {
+    std::size_t count = 0;
+    const CharT* last = nullptr;
+  };
+
+  inline namespace RIME_SIMD_NAMESPACE {
+
+    template<typename CharT>
+    inline auto scan_newlines(const CharT* first, const CharT* const last) -> newline_scan<CharT> {
+      newline_scan<CharT> result{};
+
+      if constexpr (std::same_as<CharT, char>) {
+#if defined(RIME_SIMD_AVX2)
+        const auto nl32 = _mm256_set1_epi8('\n');
+        for (; 32 <= last - first; first += 32) {
+          const auto mask = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), nl32)));
+          if (mask == 0) continue;
+          result.count += std::size_t(std::popcount(mask));
+          result.last = first + (31 - std::countl_zero(mask));
+        }
+#endif
+#if defined(RIME_SIMD_SSSE3)
+        const auto nl16 = _mm_set1_epi8('\n');
+        for (; 16 <= last - first; first += 16) {
+          const auto mask = std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), nl16)));
+          if (mask == 0) continue;
+          result.count += std::size_t(std::popcount(mask));
+          result.last = first + (31 - std::countl_zero(mask));
+        }
+#endif
+      }
+
+      for (; first != last; ++first) {
+        if (*first != CharT('\n')) continue;
+        ++result.count;
+        result.last = first;
+      }
+      return result;
+    }
+
+    // [first, last)の最初の改行、無ければlast
+    template<typename CharT>
+    inline auto find_newline(const CharT* first, const CharT* const last) -> const CharT* {
+      if constexpr (std::same_as<CharT, char>) {
+#if defined(RIME_SIMD_AVX2)
+        const auto nl32 = _mm256_set1_epi8('\n');
+        for (; 32 <= last - first; first += 32) {
+          const auto mask = std::uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(first)), nl32)));
+          if (mask != 0) return first + std::countr_zero(mask);
+        }
+#endif
+#if defined(RIME_SIMD_SSSE3)
+        const auto nl16 = _mm_set1_epi8('\n');
+        for (; 16 <= last - first; first += 16) {
+          const auto mask = std::uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first)), nl16)));
+          if (mask != 0) return first + std::countr_zero(mask);
+        }
+#endif
+      }
+
+      const auto* p = std::char_traits<CharT>::find(first, std::size_t(last - first), CharT('\n'));
+      return (p == nullptr) ? last : p;
+    }
+  }
+
+  // [first, last)でliteralが最初に現れる位置、無ければnullptr
+  // rareはリテラルの中で最も稀な文字の位置
+  template<typename CharT>
+  inline auto find_required_literal(const CharT* first, const CharT* const last, std::basic_string_view<CharT> literal, std::size_t rare) -> const CharT* {
+    while (literal.size() <= std::size_t(last - first)) {
+      const auto* p = std::char_traits<CharT>::find(first + rare, std::size_t(last - first) - literal.size() + 1, literal[rare]);
+      if (p == nullptr) break;
+
+      const auto* candidate = p - rare;
+      if (std::basic_string_view<CharT>{candidate, literal.size()} == literal) {
+        return candidate;
+      }
+      first = candidate + 1;
+    }
+    return nullptr;
+  }
+}
+
+namespace rime {
+
+  // match_linesで見つかった1行
+  template<typename CharT>
+  struct matched_line {
+    // 0始まりの行番号
+    std::size_t index = 0;
+    // 入力の先頭から行の先頭までの位置
+    std::size_t position = 0;
+    // 改行を含まない行の内容
+    std::basic_string_view<CharT> text{};
+  };
+
+  namespace detail {
+    // 行ごとにtest(line)を評価し、trueになった行を集める
+    // literalが空でなければ、全てのマッチに含まれるリテラルを入力全体から探し、それを含む行だけを評価する
+    template<typename CharT, typename Test>
+    auto collect_matched_lines(std::basic_string_view<CharT> input, std::basic_string_view<CharT> literal, std::size_t rare, Test&& test) -> std::vector<matched_line<CharT>> {
+      std::vector<matched_line<CharT>> result;
+
+      const CharT* const first = input.data();
+      const CharT* const last = first + input.size();
+      const CharT* line = first;
+      std::size_t index = 0;
+
+      // 最後の改行の後に何も無ければ、そこは行として数えない
+      while (line != last) {
+        if (not literal.empty()) {
+          const auto* hit = find_required_literal(line, last, literal, rare);
+          if (hit == nullptr) break;
+
+          // リテラルを含む行の先頭まで、行番号を進める
+          const auto skipped = scan_newlines(line, hit);
+          index += skipped.count;
+          if (skipped.last != nullptr) line = skipped.last + 1;
+        }
+
+        const auto* end = find_newline(line, last);
+        const std::basic_string_view<CharT> text{line, std::size_t(end - line)};
+        if (test(text)) {
+          result.push_back({index, std::size_t(line - first), text});
+        }
+
+        if (end == last) break;
+        line = end + 1;
+        ++index;
+      }
+
+      return result;
+    }
+  }
+
+  // 入力を改行（'\n'）で行に分け、パターンにマッチする部分を含む行を全て返す
+  // 各行は独立した入力として検索されるので、^と$は行の先頭と末尾にマッチする
+  template<regex_searcher E>
+  [[nodiscard]]
+  auto match_lines(std::basic_string_view<typename E::char_type> input, const E& engine) -> std::vector<matched_line<typename E::char_type>> {
+    using char_type = typename E::char_type;
+
+    [[maybe_unused]] typename detail::scratch_of<E>::type scratch{};
+    auto test = [&](std::basic_string_view<char_type> line) -> bool {
+      if constexpr (scratch_regex_searcher<E>) {
+        return bool(engine.search(line, 0, scratch));
+      } else {
+        return bool(engine.search(line, 0));
+      }
+    };
+
+    if constexpr (requires { E::tree; }) {
+      static constexpr auto analysis = detail::analyze_pattern(E::tree);
+      return detail::collect_matched_lines(input, analysis.literal_view(), analysis.rare_index, test);
+    } else {
+      return detail::collect_matched_lines(input, std::basic_string_view<char_type>{}, 0, test);
+    }
+  }
+
+  template<regex_usable_character CharT, typename Traits>
+  [[nodiscard]]
+  auto match_lines(std::basic_string_view<std::type_identity_t<CharT>> input, const std::basic_regex<CharT, Traits>& re) -> std::vector<matched_line<CharT>> {
+    return detail::collect_matched_lines(input, std::basic_string_view<CharT>{}, 0, [&](std::basic_string_view<CharT> line) {
+      return std::regex_search(line.data(), line.data() + line.size(), re);
+    });
+  }
+
+  template<fixed_string Pattern>
+  [[nodiscard]]
+  auto match_lines(std::basic_string_view<typename decltype(Pattern)::char_type> input) {
+    return match_lines(input, detail::shared_engine<Pattern>());
+  }
+}
+
+#if defined(RIME_MAPPED_FILE_WIN32) || defined(RIME_MAPPED_FILE_POSIX)
+
+namespace rime {
+
+  // 読み取り専用でメモリにマップしたファイル
+  // view()はマップした領域をそのまま指し、ファイルの内容をコピーしない
+  // ムーブしても領域のアドレスは変わらない
+  class mapped_file {
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+
+    [[noreturn]]
+    static void fail(int code, const std::error_category& category, const char* what) {
+      throw std::system_error(code, category, what);
+    }
+
+    void unmap() noexcept {
+      if (m_data == nullptr) return;
+#if defined(RIME_MAPPED_FILE_WIN32)
+      ::UnmapViewOfFile(m_data);
+#else
+      ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+      m_data = nullptr;
+      m_size = 0;
+    }
+
+  public:
+    mapped_file() = default;
+
+    // 空のファイルはマップせず、空のview()になる
+    explicit mapped_file(const std::filesystem::path& path) {
+#if defined(RIME_MAPPED_FILE_WIN32)
+      // 先頭から順に読むことをキャッシュマネージャに伝える
+      const HANDLE file = ::CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+      if (file == INVALID_HANDLE_VALUE) {
+        fail(int(::GetLastError()), std::system_category(), "rime::mapped_file : CreateFileW");
+      }
+
+      LARGE_INTEGER size{};
+      if (not ::GetFileSizeEx(file, &size)) {
+        const auto code = int(::GetLastError());
+        ::CloseHandle(file);
+        fail(code, std::system_category(), "rime::mapped_file : GetFileSizeEx");
+      }
+      if (std::numeric_limits<std::size_t>::max() < std::uint64_t(size.QuadPart)) {
+        ::CloseHandle(file);
+        fail(int(std::errc::file_too_large), std::generic_category(), "rime::mapped_file");
+      }
+      if (size.QuadPart == 0) {
+        ::CloseHandle(file);
+        return;
+      }
+
+      const HANDLE mapping = ::CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      const auto mapping_error = int(::GetLastError());
+      ::CloseHandle(file);
+      if (mapping == nullptr) {
+        fail(mapping_error, std::system_category(), "rime::mapped_file : CreateFileMappingW");
+      }
+
+      // ビューはマッピングのハンドルを閉じても有効
+      const void* data = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      const auto view_error = int(::GetLastError());
+      ::CloseHandle(mapping);
+      if (data == nullptr) {
+        fail(view_error, std::system_category(), "rime::mapped_file : MapViewOfFile");
+      }
+
+      m_data = static_cast<const char*>(data);
+      m_size = std::size_t(size.QuadPart);
+#else
+      const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        fail(errno, std::generic_category(), "rime::mapped_file : open");
+      }
+
+      struct ::stat st{};
+      if (::fstat(fd, &st) != 0) {
+        const int code = errno;
+        ::close(fd);
+        fail(code, std::generic_category(), "rime::mapped_file : fstat");
+      }
+      // パイプやデバイスはマップできない
+      if (not S_ISREG(st.st_mode)) {
+        ::close(fd);
+        fail(int(std::errc::invalid_argument), std::generic_category(), "rime::mapped_file : not a regular file");
+      }
+      if (std::numeric_limits<std::size_t>::max() < std::uintmax_t(st.st_size)) {
+        ::close(fd);
+        fail(int(std::errc::file_too_large), std::generic_category(), "rime::mapped_file");
+      }
+      if (st.st_size == 0) {
+        ::close(fd);
+        return;
+      }
+
+      const auto size = std::size_t(st.st_size);
+      // マップはファイルディスクリプタを閉じても有効
+      void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      const int code = errno;
+      ::close(fd);
+      if (data == MAP_FAILED) {
+        fail(code, std::generic_category(), "rime::mapped_file : mmap");
+      }
+
+      // 先頭から順に読むので、先読みを増やし読み終えたページを早く手放してもらう（失敗しても検索には影響しない）
+      ::madvise(data, size, MADV_SEQUENTIAL);
+
+      m_data = static_cast<const char*>(data);
+      m_size = size;
+#endif
+    }
+
+    mapped_file(mapped_file&& other) noexcept
+      : m_data(std::exchange(other.m_data, nullptr))
+      , m_size(std::exchange(other.m_size, 0))
+    {}
+
+    auto operator=(mapped_file&& other) noexcept -> mapped_file& {
+      if (this != &other) {
+        unmap();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+      }
+      return *this;
+    }
+
+    ~mapped_file() {
+      unmap();
+    }
+
+    [[nodiscard]]
+    auto data() const noexcept -> const char* {
+      return m_data;
+    }
+
+    [[nodiscard]]
+    auto size() const noexcept -> std::size_t {
+      return m_size;
+    }
+
+    [[nodiscard]]
+    auto view() const noexcept -> std::string_view {
+      return {m_data, m_size};
+    }
+  };
+}
+
+namespace rime::ranges {
+
+  // ファイルをマップして、その中をregex_searchesで検索するview
+  // マッチ結果の文字列はマップした領域を指し、position()はファイル先頭からのバイト位置
+  // 左辺値で渡したエンジンとstd::regexは、このviewより長く生存している必要がある
+  template<typename E>
+  class grep_file_view : public std::ranges::view_interface<grep_file_view<E>> {
+    mapped_file m_file{};
+    [[no_unique_address]] detail::engine_holder<E> m_engine{};
+
+  public:
+    grep_file_view() = default;
+
+    grep_file_view(mapped_file file, detail::engine_holder<E> engine)
+      : m_file(std::move(file))
+      , m_engine(std::move(engine))
+    {}
+
+    grep_file_view(grep_file_view&&) = default;
+    auto operator=(grep_file_view&&) -> grep_file_view& = default;
+
+    // イテレータはマップした領域とエンジンだけを参照するので、viewをムーブしても有効
+    auto begin() const {
+      return rime::regex_searches(m_file.view(), m_engine.get()).begin();
+    }
+
+    auto end() const {
+      return rime::regex_searches(m_file.view(), m_engine.get()).end();
+    }
+
+    // マップしたファイル全体
+    auto file() const noexcept -> const mapped_file& {
+      return m_file;
+    }
+  };
+}
+
+namespace rime {
+
+  // ファイルをコピーせずにメモリにマップして、パターンにマッチする部分を全て検索する
+  // 一時オブジェクトのエンジンはviewが所有する
+  template<typename Engine, regex_searcher E = std::remove_cvref_t<Engine>>
+    requires std::same_as<typename E::char_type, char>
+  [[nodiscard]]
+  auto grep_file(const std::filesystem::path& path, Engine&& engine) -> ranges::grep_file_view<E> {
+    return ranges::grep_file_view<E>{mapped_file{path}, std::forward<Engine>(engine)};
+  }
+
+  [[nodiscard]]
+  inline auto grep_file(const std::filesystem::path& path, const std::regex& re) -> ranges::grep_file_view<std::regex> {
+    return ranges::grep_file_view<std::regex>{mapped_file{path}, re};
+  }
+
+  // 一時オブジェクトのstd::regexは参照が切れる
+  auto grep_file(const std::filesystem::path&, const std::regex&&) = delete;
+
+  template<fixed_string Pattern>
+    requires std::same_as<typename decltype(Pattern)::char_type, char>
+  [[nodiscard]]
+  auto grep_file(const std::filesystem::path& path) {
+    return grep_file(path, detail::shared_engine<Pattern>());
+  }
+}
+
+#endif
+
+namespace rime::detail {
+
+  // コピーやムーブで中身を引き継がないキャッシュ（begin()の結果を保持する）
+  template<typename T>
+  class non_propagating_cache {
+    std::optional<T> m_value{};
+
+  public:
+    non_propagating_cache() = default;
+
+    constexpr non_propagating_cache(const non_propagating_cache&) noexcept {}
+
+    constexpr non_propagating_cache(non_propagating_cache&& other) noexcept {
+      other.m_value.reset();
+    }
+
+    constexpr auto operator=(const non_propagating_cache& other) noexcept -> non_propagating_cache& {
+      if (this != std::addressof(other)) m_value.reset();
+      return *this;
+    }
+
+    constexpr auto operator=(non_propagating_cache&& other) noexcept -> non_propagating_cache& {
+      m_value.reset();
+      other.m_value.reset();
+      return *this;
+    }
+
+    constexpr auto has_value() const noexcept -> bool {
+      return m_value.has_value();
+    }
+
+    constexpr auto operator*() const -> const T& {
+      return *m_value;
+    }
+
+    constexpr auto emplace(T value) -> const T& {
+      return m_value.emplace(std::move(value));
+    }
+  };
+
+  struct empty_cache {};
+
+  // 参照型が左辺値参照のときだけC++17のイテレータとして振る舞える
+  template<typename V>
+  struct filter_iterator_category {};
+
+  template<std::ranges::forward_range V>
+  struct filter_iterator_category<V> {
+    using iterator_category = std::conditional_t<
+      not std::is_lvalue_reference_v<std::ranges::range_reference_t<V>>,
+      std::input_iterator_tag,
+      std::conditional_t<std::ranges::bidirectional_range<V>, std::bidirectional_iterator_tag, std::forward_iterator_tag>
+    >;
+  };
+}
+
+namespace rime::ranges {
+
+  // 文字列の範囲から、正規表現にマッチする要素だけを遅延評価で取り出すview
+  // Matchがfalseならstd::regex_search、trueならstd::regex_matchで判定し、部分マッチは求めない
+  // 正規表現はshared_ptrで持ち、参照から作った場合は所有しないので、viewのコピーで正規表現はコピーされない
+  template<std::ranges::view V, typename CharT = char, bool Match = false>
+    requires std::ranges::input_range<V> and std::convertible_to<std::ranges::range_reference_t<V>, std::basic_string_view<CharT>>
+  class regex_filter_view : public std::ranges::view_interface<regex_filter_view<V, CharT, Match>> {
+  public:
+    using regex_type = std::basic_regex<CharT>;
+    using pointer = std::shared_ptr<const regex_type>;
+
+  private:
+    using view_type = std::basic_string_view<CharT>;
+    using base_iterator = std::ranges::iterator_t<V>;
+    using base_sentinel = std::ranges::sentinel_t<V>;
+
+    V m_view = V();
+    pointer m_regex{};
+    std::regex_constants::match_flag_type m_flags = std::regex_constants::match_default;
+    [[no_unique_address]] std::conditional_t<std::ranges::forward_range<V>, detail::non_propagating_cache<base_iterator>, detail::empty_cache> m_begin{};
+
+    auto satisfies(const base_iterator& it) const -> bool {
+      // *itが一時オブジェクトでも判定の間は生存させる
+      auto&& value = *it;
+      const view_type str = value;
+
+      if constexpr (Match) {
+        return std::regex_match(str.begin(), str.end(), *m_regex, m_flags);
+      } else {
+        return std::regex_search(str.begin(), str.end(), *m_regex, m_flags);
+      }
+    }
+
+    auto find_next(base_iterator it) -> base_iterator {
+      const auto last = std::ranges::end(m_view);
+      while (it != last and not satisfies(it)) ++it;
+      return it;
+    }
+
+    class iterator : public detail::filter_iterator_category<V> {
+      regex_filter_view* m_parent = nullptr;
+      base_iterator m_current = base_iterator();
+
+    public:
+      using iterator_concept = std::conditional_t<
+        std::ranges::bidirectional_range<V>, std::bidirectional_iterator_tag,
+        std::conditional_t<std::ranges::forward_range<V>, std::forward_iterator_tag, std::input_iterator_tag>
+      >;
+      using value_type = std::ranges::range_value_t<V>;
+      using difference_type = std::ranges::range_difference_t<V>;
+
+      iterator() requires std::default_initializable<base_iterator> = default;
+
+      iterator(regex_filter_view& parent, base_iterator current)
+        : m_parent(std::addressof(parent))
+        , m_current(std::move(current))
+      {}
+
+      auto base() const & -> const base_iterator& {
+        return m_current;
+      }
+
+      auto base() && -> base_iterator {
+        return std::move(m_current);
+      }
+
+      auto operator*() const -> std::ranges::range_reference_t<V> {
+        return *m_current;
+      }
+
+      auto operator++() -> iterator& {
+        m_current = m_parent->find_next(std::ranges::next(std::move(m_current)));
+        return *this;
+      }
+
+      void operator++(int) {
+        ++*this;
+      }
+
+      auto operator++(int) -> iterator requires std::ranges::forward_range<V> {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+
+      auto operator--() -> iterator& requires std::ranges::bidirectional_range<V> {
+        do {
+          --m_current;
+        } while (not m_parent->satisfies(m_current));
+        return *this;
+      }
+
+      auto operator--(int) -> iterator requires std::ranges::bidirectional_range<V> {
+        auto copy = *this;
+        --*this;
+        return copy;
+      }
+
+      friend auto operator==(const iterator& lhs, const iterator& rhs) -> bool
+        requires std::equality_comparable<base_iterator>
+      {
+        return lhs.m_current == rhs.m_current;
+      }
+    };
+
+    class sentinel {
+      base_sentinel m_end = base_sentinel();
+
+    public:
+      sentinel() = default;
+
+      explicit sentinel(base_sentinel end)
+        : m_end(std::move(end))
+      {}
+
+      friend auto operator==(const iterator& it, const sentinel& s) -> bool {
+        return it.base() == s.m_end;
+      }
+    };
+
+  public:
+    regex_filter_view() requires std::default_initializable<V> = default;
+
+    regex_filter_view(V view, pointer regex, std::regex_constants::match_flag_type flags = std::regex_constants::match_default)
+      : m_view(std::move(view))
+      , m_regex(std::move(regex))
+      , m_flags(flags)
+    {
+      assert(m_regex != nullptr);
+    }
+
+    // 所有しない、reはviewより長く生存しなければならない
+    regex_filter_view(V view, const regex_type& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default)
+      : regex_filter_view(std::move(view), pointer(pointer(), std::addressof(re)), flags)
+    {}
+
+    regex_filter_view(V view, regex_type&& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default)
+      : regex_filter_view(std::move(view), std::make_shared<const regex_type>(std::move(re)), flags)
+    {}
+
+    auto base() const & -> V requires std::copy_constructible<V> {
+      return m_view;
+    }
+
+    auto base() && -> V {
+      return std::move(m_view);
+    }
+
+    auto regex() const -> const regex_type& {
+      return *m_regex;
+    }
+
+    // forward_rangeでは最初の要素の位置をキャッシュし、2回目以降はO(1)
+    auto begin() -> iterator {
+      if constexpr (std::ranges::forward_range<V>) {
+        if (not m_begin.has_value()) {
+          m_begin.emplace(find_next(std::ranges::begin(m_view)));
+        }
+        return iterator{*this, *m_begin};
+      } else {
+        return iterator{*this, find_next(std::ranges::begin(m_view))};
+      }
+    }
+
+    auto end() {
+      if constexpr (std::ranges::common_range<V>) {
+        return iterator{*this, std::ranges::end(m_view)};
+      } else {
+        return sentinel{std::ranges::end(m_view)};
+      }
+    }
+  };
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, std::basic_regex<CharT>&&) -> regex_filter_view<std::views::all_t<R>, CharT>;
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, std::basic_regex<CharT>&&, std::regex_constants::match_flag_type) -> regex_filter_view<std::views::all_t<R>, CharT>;
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, const std::basic_regex<CharT>&) -> regex_filter_view<std::views::all_t<R>, CharT>;
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, const std::basic_regex<CharT>&, std::regex_constants::match_flag_type) -> regex_filter_view<std::views::all_t<R>, CharT>;
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, std::shared_ptr<const std::basic_regex<CharT>>) -> regex_filter_view<std::views::all_t<R>, CharT>;
+
+  template<typename R, typename CharT>
+  regex_filter_view(R&&, std::shared_ptr<const std::basic_regex<CharT>>, std::regex_constants::match_flag_type) -> regex_filter_view<std::views::all_t<R>, CharT>;
+}
+
+namespace rime::detail {
+
+  // views::regex_filter(re)の戻り値、範囲と|で繋ぐ
+  template<typename CharT, bool Match>
+  class regex_filter_closure {
+    std::shared_ptr<const std::basic_regex<CharT>> m_regex;
+    std::regex_constants::match_flag_type m_flags;
+
+  public:
+    regex_filter_closure(std::shared_ptr<const std::basic_regex<CharT>> regex, std::regex_constants::match_flag_type flags)
+      : m_regex(std::move(regex))
+      , m_flags(flags)
+    {}
+
+    template<std::ranges::viewable_range R>
+    auto operator()(R&& r) const {
+      return ranges::regex_filter_view<std::views::all_t<R>, CharT, Match>{std::views::all(std::forward<R>(r)), m_regex, m_flags};
+    }
+
+    template<std::ranges::viewable_range R>
+    friend auto operator|(R&& r, const regex_filter_closure& closure) {
+      return closure(std::forward<R>(r));
+    }
+  };
+
+  template<bool Match>
+  struct regex_filter_adaptor {
+    // 参照から作る場合は所有しない
+    template<typename CharT>
+    auto operator()(const std::basic_regex<CharT>& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) const {
+      return regex_filter_closure<CharT, Match>{std::shared_ptr<const std::basic_regex<CharT>>(std::shared_ptr<const std::basic_regex<CharT>>(), std::addressof(re)), flags};
+    }
+
+    template<typename CharT>
+    auto operator()(std::basic_regex<CharT>&& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) const {
+      return regex_filter_closure<CharT, Match>{std::make_shared<const std::basic_regex<CharT>>(std::move(re)), flags};
+    }
+
+    template<typename CharT>
+    auto operator()(std::shared_ptr<const std::basic_regex<CharT>> re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) const {
+      return regex_filter_closure<CharT, Match>{std::move(re), flags};
+    }
+
+    template<std::ranges::viewable_range R, typename Regex>
+    auto operator()(R&& r, Regex&& re, std::regex_constants::match_flag_type flags = std::regex_constants::match_default) const {
+      return (*this)(std::forward<Regex>(re), flags)(std::forward<R>(r));
+    }
+  };
+}
+
+namespace rime::ranges {
+
+  namespace views {
+
+    // 部分にマッチする要素を残す（std::regex_search）
+    inline constexpr detail::regex_filter_adaptor<false> regex_filter{};
+
+    // 全体がマッチする要素を残す（std::regex_match）
+    inline constexpr detail::regex_filter_adaptor<true> regex_match_filter{};
+  }
+}
+
+namespace rime {
+  namespace views = ranges::views;
 }
 
 #undef fn
+#undef RIME_SIMD_AVX2
+#undef RIME_SIMD_SSSE3
+#undef RIME_SIMD_NAMESPACE
+#undef RIME_MAPPED_FILE_WIN32
+#undef RIME_MAPPED_FILE_POSIX
 #ifndef RIME_TEST
 #undef LITERAL
 #endif
@@ -1,6 +1,17 @@
 #include <concepts>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <cstdlib>
+#include <new>
+#include <fstream>
+#include <filesystem>
+#include <memory_resource>
 
 #define RIME_TEST 1
+#define RIME_ENABLE_MAPPED_FILE 1
 #include "rime.hpp"
 
 #define BOOST_UT_DISABLE_MODULE
@@ -8,6 +19,49 @@
 
 namespace ut = boost::ut;
 
+// 動的メモリ確保の回数
+namespace {
+  std::atomic<std::size_t> allocation_count = 0;
+}
+
+void* operator new(std::size_t size) {
+  ++allocation_count;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc{};
+}
+
+// インライン展開されるとGCCがnewとfreeの組み合わせを警告する
+[[gnu::noinline]]
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+[[gnu::noinline]]
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+// 確保の回数を数えるmemory_resource
+class counting_resource : public std::pmr::memory_resource {
+  std::pmr::memory_resource* m_upstream = std::pmr::new_delete_resource();
+
+  auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override {
+    ++allocations;
+    return m_upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+    m_upstream->deallocate(p, bytes, alignment);
+  }
+
+  auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override {
+    return this == &other;
+  }
+
+public:
+  std::size_t allocations = 0;
+};
+
 int main() {
   using namespace boost::ut::literals;
   using namespace boost::ut::operators::terse;
@@ -803,6 +857,1632 @@ int main() {
     }));
   };
 
+  "syntax tree"_test = [] {
+    using rime::node_kind;
+    using rime::syntax_node;
+
+    {
+      constexpr auto tree = rime::parse<R"(a(b|c)*?\d{2,})">();
+      static_assert(tree.capture_group_count == 1);
+
+      // ルートは連接
+      const auto& root = tree.nodes[tree.root];
+      ut::expect(root.kind == node_kind::concatenation);
+
+      const auto& a = tree.nodes[root.child];
+      ut::expect(a.kind == node_kind::character);
+      ut::expect(a.first == std::size_t('a'));
+
+      const auto& star = tree.nodes[a.sibling];
+      ut::expect(star.kind == node_kind::repeat);
+      ut::expect(star.first == 0_ull);
+      ut::expect(star.last == syntax_node::npos);
+      ut::expect(star.flag == false);
+
+      const auto& group = tree.nodes[star.child];
+      ut::expect(group.kind == node_kind::capture);
+      ut::expect(group.first == 1_ull);
+      ut::expect(tree.nodes[group.child].kind == node_kind::alternation);
+
+      const auto& digits = tree.nodes[star.sibling];
+      ut::expect(digits.kind == node_kind::repeat);
+      ut::expect(digits.first == 2_ull);
+      ut::expect(digits.last == syntax_node::npos);
+      ut::expect(digits.flag == true);
+      ut::expect(digits.sibling == syntax_node::npos);
+
+      const auto& d = tree.nodes[digits.child];
+      ut::expect(d.kind == node_kind::char_class);
+      ut::expect(tree.class_items[d.first].kind == rime::class_item_kind::builtin);
+      ut::expect(tree.class_items[d.first].first == std::size_t(rime::builtin_class::digit));
+    }
+    {
+      // エスケープシーケンスはデコードされている
+      constexpr auto tree = rime::parse<R"(\x41\u3042\cA\n\0)">();
+      constexpr std::size_t expects[] = {0x41, 0x3042, 1, 10, 0};
+
+      std::size_t i = 0;
+      for (auto n = tree.nodes[tree.root].child; n != syntax_node::npos; n = tree.nodes[n].sibling, ++i) {
+        ut::expect(tree.nodes[n].kind == node_kind::character);
+        ut::expect(tree.nodes[n].first == expects[i]) << i;
+      }
+      ut::expect(i == 5_ull);
+    }
+    {
+      constexpr auto tree = rime::parse<LR"([^a-z_[:digit:]\w-])">();
+      const auto& cls = tree.nodes[tree.nodes[tree.root].child];
+      ut::expect(cls.kind == node_kind::char_class);
+      ut::expect(cls.flag == true);
+      ut::expect(cls.last - cls.first == 5_ull);
+      ut::expect(tree.class_items[cls.first].first == std::size_t('a'));
+      ut::expect(tree.class_items[cls.first].last == std::size_t('z'));
+      ut::expect(tree.class_items[cls.first + 2].first == std::size_t(rime::builtin_class::digit));
+      ut::expect(tree.class_items[cls.first + 4].first == std::size_t('-'));
+    }
+    {
+      constexpr auto tree = rime::parse<R"(^(?:x)(?=y)(?!z)(w)\1$)">();
+      static_assert(tree.capture_group_count == 1);
+      constexpr node_kind expects[] = {node_kind::line_begin, node_kind::group, node_kind::lookahead, node_kind::negative_lookahead, node_kind::capture, node_kind::back_reference, node_kind::line_end};
+
+      std::size_t i = 0;
+      for (auto n = tree.nodes[tree.root].child; n != syntax_node::npos; n = tree.nodes[n].sibling, ++i) {
+        ut::expect(tree.nodes[n].kind == expects[i]) << i;
+      }
+    }
+  };
+
+  "static_regex"_test = [] {
+    {
+      using re = rime::static_regex<R"((\w+)@(\w+)\.com)">;
+
+      constexpr auto m = re::search("mail: foo@bar.com!");
+      static_assert(m);
+      ut::expect(m.str() == "foo@bar.com"sv);
+      ut::expect(m[1] == "foo"sv);
+      ut::expect(m[2] == "bar"sv);
+      ut::expect(m.position() == 6_ull);
+      ut::expect(m.prefix() == "mail: "sv);
+      ut::expect(m.suffix() == "!"sv);
+
+      ut::expect(not re::match("mail: foo@bar.com!"));
+      ut::expect(bool(re::match("foo@bar.com")));
+    }
+    {
+      // ECMAScriptのバックトラックの優先順位
+      constexpr auto m = rime::static_regex<R"((a|ab)(c|bcd)(d*))">::match("abcd");
+      static_assert(m);
+      ut::expect(m[1] == "a"sv);
+      ut::expect(m[2] == "bcd"sv);
+      ut::expect(m[3] == ""sv);
+
+      static_assert(rime::static_regex<R"(a+?b|c+)">::match("aab"));
+      static_assert(not rime::static_regex<R"(a+?b|c+)">::match("aabc"));
+      static_assert(rime::static_regex<R"((?:ab){2,3})">::match("ababab"));
+      static_assert(not rime::static_regex<R"((?:ab){2,3})">::match("abababab"));
+      static_assert(rime::static_regex<R"((a*)*b)">::match("aaab"));
+      static_assert(rime::static_regex<R"((\d)-\1)">::match("3-3"));
+      static_assert(not rime::static_regex<R"((\d)-\1)">::match("3-4"));
+      static_assert(rime::static_regex<R"(^\bfoo(?=bar)(?!baz))">::search("foobar"));
+      static_assert(not rime::static_regex<R"(^\bfoo(?=bar)(?!baz))">::search("xfoobar"));
+      static_assert(rime::static_regex<R"([^\x00-\x1f][[:upper:]]A.$)">::match("aZA!"));
+      static_assert(not rime::static_regex<R"(a.b)">::match("a\nb"));
+      static_assert(rime::static_regex<LR"([[:alpha:]]+\d)">::match(L"abc1"));
+    }
+    {
+      std::string_view expects[] = {"1421", "34353", "7685", "12765", "976754"};
+
+      int i = 0;
+      for (const auto &m : rime::static_regex<R"(\d+)">::searches("1421, 34353, 7685, 12765, 976754")) {
+        ut::expect(m.str() == expects[i]) << i;
+        ++i;
+      }
+      ut::expect(i == 5_i);
+
+      [[maybe_unused]]
+      std::ranges::forward_range auto r1 = rime::static_regex<R"(\d+)">::searches("1421, 34353");
+      [[maybe_unused]]
+      std::ranges::viewable_range auto r2 = rime::regex_searches("1421, 34353", rime::static_regex<R"(\d+)">{});
+    }
+    {
+      // 空のマッチの扱いはstd::regex_iteratorと同じ
+      std::size_t expects[] = {0, 1, 3, 4};
+
+      int i = 0;
+      for (const auto &m : rime::static_regex<R"(x*)">::searches("axxb")) {
+        ut::expect(m.position() == expects[i]) << i;
+        ++i;
+      }
+      ut::expect(i == 4_i);
+    }
+    {
+      // 1通りにしかマッチしない本体の繰り返しは再帰しないので、長い入力でもスタックを使い切らない
+      std::string input;
+      for (int i = 0; i < (1 << 20); ++i) input += "ab";
+
+      ut::expect(bool(rime::static_regex<R"((?:ab)*)">::match(input)));
+      ut::expect(rime::static_regex<R"((?:ab)+?b)">::search(input + "b").length() == input.size() + 1);
+      ut::expect(rime::static_regex<R"((?:a[a-z]){3,}c)">::search(input + "c").position() == 0_ull);
+      ut::expect(not rime::static_regex<R"(^(?:ab)*a$)">::search(input));
+
+      static_assert(rime::static_regex<R"((?:ab){2,3}ab)">::match("abababab"));
+      static_assert(not rime::static_regex<R"((?:ab){2,}?ab)">::match("abab"));
+      static_assert(rime::static_regex<R"(x(?:\bab){0,2})">::search("x ab").length() == 1);
+    }
+  };
+
+  "static_dfa"_test = [] {
+    {
+      using dfa = rime::static_dfa<R"((\w+)@(\w+)\.com)">;
+
+      static_assert(dfa::search("mail: foo@bar.com!"));
+      static_assert(not dfa::search("mail: foo@bar.org!"));
+      static_assert(not dfa::match("mail: foo@bar.com!"));
+      static_assert(dfa::match("foo@bar.com"));
+      ut::expect(dfa::search("mail: foo@bar.com!"sv));
+      ut::expect(not dfa::match("foo@@bar.com"sv));
+    }
+    {
+      static_assert(rime::static_dfa<R"((a|ab)(c|bcd)(d*))">::match("abcd"));
+      static_assert(rime::static_dfa<R"((?:ab){2,3})">::match("ababab"));
+      static_assert(not rime::static_dfa<R"((?:ab){2,3})">::match("abababab"));
+      static_assert(rime::static_dfa<R"((a*)*b)">::match("aaab"));
+      static_assert(rime::static_dfa<R"(x*)">::match(""));
+      static_assert(not rime::static_dfa<R"(x+)">::match(""));
+      static_assert(rime::static_dfa<R"([^\x00-\x1f][[:upper:]]A.$)">::match("aZA!"));
+      static_assert(not rime::static_dfa<R"(a.b)">::match("a\nb"));
+      static_assert(rime::static_dfa<R"(a{2,}?)">::match("aaaa"));
+    }
+    {
+      // アンカー
+      using dfa = rime::static_dfa<R"(^ab|cd$)">;
+      static_assert(dfa::search("abxx"));
+      static_assert(not dfa::search("xabx"));
+      static_assert(dfa::search("xxcd"));
+      static_assert(not dfa::search("xcdx"));
+      static_assert(not rime::static_dfa<R"(^$)">::search("abc"));
+      static_assert(rime::static_dfa<R"(^$)">::search(""));
+      static_assert(rime::static_dfa<R"($)">::search("abc"));
+      static_assert(rime::static_dfa<R"(a$|b)">::match("a"));
+    }
+    {
+      // 最小化によって等価な状態はまとめられる
+      static_assert(rime::static_dfa<R"(a|a)">::match_table.accept.size() == rime::static_dfa<R"(a)">::match_table.accept.size());
+      static_assert(rime::static_dfa<R"((?:a|b)*abb)">::match_table.accept.size() == 5);
+    }
+  };
+
+  "compiled_regex"_test = [] {
+    {
+      // 必須リテラルの抽出
+      constexpr auto a1 = rime::compiled_regex<R"(ERROR: \d+)">::analysis;
+      static_assert(a1.literal_view() == "ERROR: ");
+      static_assert(a1.literal_offset_min == 0 and a1.literal_offset_max == 0);
+      static_assert(a1.min_length == 8 and a1.max_length == rime::syntax_node::npos);
+
+      constexpr auto a2 = rime::compiled_regex<R"(\w{2,4}-(user=)?(id=x+)\d)">::analysis;
+      static_assert(a2.literal_view() == "id=x");
+      static_assert(a2.literal_offset_min == 3 and a2.literal_offset_max == 10);
+
+      static_assert(rime::compiled_regex<R"(a|b)">::analysis.literal_length == 0);
+      static_assert(rime::compiled_regex<R"(.*foo)">::analysis.literal_offset_max == rime::syntax_node::npos);
+    }
+    {
+      const auto re = rime::regex<R"(user=(\w+))">();
+
+      auto m = re.search("time=1 user=alice ip=::1 user=bob");
+      ut::expect(bool(m));
+      ut::expect(m.position() == 7_ull);
+      ut::expect(m[1] == "alice"sv);
+
+      std::string_view expects[] = {"alice", "bob"};
+      int i = 0;
+      for (const auto& m2 : rime::regex_searches("time=1 user=alice ip=::1 user=bob", re)) {
+        ut::expect(m2[1] == expects[i]) << i;
+        ++i;
+      }
+      ut::expect(i == 2_i);
+
+      ut::expect(not re.search("user= nobody"));
+      ut::expect(bool(re.match("user=x")));
+      ut::expect(not re.match("user=x "));
+    }
+    {
+      // 前処理の有無でstd::regex_searchと同じ結果になる
+      const auto check = [](const auto& re, std::string_view input) {
+        std::match_results<const char*> expect;
+        const bool found = std::regex_search(input.data(), input.data() + input.size(), expect, re.regex());
+        const auto m = re.search(input);
+
+        ut::expect(bool(m) == found) << input;
+        if (found and m) {
+          ut::expect(m.position() == std::size_t(expect.position(0))) << input;
+          ut::expect(m.length() == std::size_t(expect.length(0))) << input;
+        }
+      };
+
+      std::string_view inputs[] = {"", "ab", "xx-id=xx7", "abcd-id=x9", "a-id=x1", "abcde-id=x1 ab-user=id=xx2", "id=x1id=x2 zz-id=x3", "^^abc^", "fooabc$", "aaabc", "\nabc"};
+      for (const auto input : inputs) {
+        check(rime::regex<R"(\w{2,4}-(user=)?(id=x+)\d)">(), input);
+        check(rime::regex<R"(^abc)">(), input);
+        check(rime::regex<R"(\babc$)">(), input);
+        check(rime::regex<R"(.*abc)">(), input);
+        check(rime::regex<R"(a{2,}bc)">(), input);
+        check(rime::regex<R"((?:x|y)id=)">(), input);
+      }
+    }
+  };
+
+  "literal_regex"_test = [] {
+    {
+      static_assert(std::same_as<decltype(rime::regex<R"(a\.b\x41\u0042\cJ)">()), rime::literal_regex<R"(a\.b\x41\u0042\cJ)">>);
+      static_assert(rime::literal_regex<R"(a\.b\x41\u0042\cJ)">::literal == "a.bAB\n");
+      static_assert(std::same_as<decltype(rime::regex<R"(a.b)">()), rime::compiled_regex<R"(a.b)">>);
+      static_assert(std::same_as<decltype(rime::regex<R"((ab))">()), rime::compiled_regex<R"((ab))">>);
+    }
+    {
+      const auto re = rime::regex<"ERROR">();
+
+      auto m = re.search("INFO ok\nERROR disk\nERROR net");
+      ut::expect(bool(m));
+      ut::expect(m.position() == 8_ull);
+      ut::expect(m.str() == "ERROR"sv);
+      ut::expect(m.suffix() == " disk\nERROR net"sv);
+
+      std::size_t expects[] = {8, 19};
+      int i = 0;
+      for (const auto& m2 : rime::regex_searches("INFO ok\nERROR disk\nERROR net", re)) {
+        ut::expect(m2.position() == expects[i]) << i;
+        ++i;
+      }
+      ut::expect(i == 2_i);
+
+      ut::expect(not re.search("ERRO"));
+      ut::expect(bool(re.match("ERROR")));
+      ut::expect(not re.match("ERRORS"));
+    }
+    {
+      const auto re = rime::regex<"x">();
+      ut::expect(re.search("abcxx", 4).position() == 4_ull);
+      ut::expect(not re.search("abc"));
+
+      const auto wre = rime::regex<L"\u3042\u3044">();
+      ut::expect(wre.search(L"\u3044\u3042\u3042\u3044").position() == 2_ull);
+    }
+  };
+
+  "literal_alternation"_test = [] {
+    {
+      using re = rime::literal_alternation<"GET|POST|PUT|DELETE|PATCH">;
+      static_assert(std::same_as<decltype(rime::regex<"GET|POST|PUT|DELETE|PATCH">()), re>);
+      static_assert(std::same_as<decltype(rime::regex<"GET|(POST)">()), rime::compiled_regex<"GET|(POST)">>);
+
+      constexpr auto m = re::search("> PUT /index.html");
+      static_assert(m);
+      static_assert(m.position() == 2 and m.str() == "PUT");
+      static_assert(re::match("PATCH"));
+      static_assert(not re::match("PATC"));
+
+      std::string_view expects[] = {"GET", "POST", "PATCH", "DELETE"};
+      int i = 0;
+      for (const auto& m2 : rime::regex_searches("GET,POST;PATCH DELETEX", re{})) {
+        ut::expect(m2.str() == expects[i]) << i;
+        ++i;
+      }
+      ut::expect(i == 4_i);
+    }
+    {
+      // 同じ位置から始まる場合は前の選択肢を優先し、std::regex_searchと同じ結果になる
+      static_assert(rime::literal_alternation<"a|ab">::search("xab").str() == "a");
+      static_assert(rime::literal_alternation<"ab|a">::search("xab").str() == "ab");
+      static_assert(rime::literal_alternation<"bcd|abcde|c">::search("abcdx").str() == "bcd");
+      static_assert(rime::literal_alternation<"bcd|abcde|c">::search("abcde").str() == "abcde");
+      static_assert(rime::literal_alternation<"he|she|hers|his">::search("ushers").position() == 1);
+      static_assert(rime::literal_alternation<"ab|b">::match("b"));
+
+      const auto check = [](const auto& re, std::string_view pattern, std::string_view input) {
+        std::match_results<const char*> expect;
+        const bool found = std::regex_search(input.data(), input.data() + input.size(), expect, std::regex(pattern.data(), pattern.size()));
+        const auto m = re.search(input);
+
+        ut::expect(bool(m) == found) << input;
+        if (found and m) {
+          ut::expect(m.position() == std::size_t(expect.position(0))) << input;
+          ut::expect(m.length() == std::size_t(expect.length(0))) << input;
+        }
+      };
+
+      std::string_view inputs[] = {"", "a", "aab", "aaba", "baab", "abba", "babab", "bbbab", "aaaaaa"};
+      for (const auto input : inputs) {
+        check(rime::literal_alternation<"ab|a|aab|bab|b">{}, "ab|a|aab|bab|b", input);
+        check(rime::literal_alternation<"aaa|ba|ab|bb">{}, "aaa|ba|ab|bb", input);
+      }
+    }
+    {
+      using set = rime::literal_set<"ERROR", "WARN", "FATAL">;
+      static_assert(set::size == 3);
+
+      constexpr auto m = set::find("[2024] WARN: disk");
+      static_assert(m.index == 1 and m.position == 7 and m.length == 4);
+      static_assert(not set::find("INFO"));
+      static_assert(set::match("FATAL"));
+
+      using wset = rime::literal_set<L"\u3042\u3044", L"\u3044">;
+      static_assert(wset::find(L"x\u3044\u3042\u3044").index == 1);
+      static_assert(wset::find(L"x\u3044\u3042\u3044", 2).index == 0);
+    }
+  };
+
+  "char_bitmap"_test = [] {
+    {
+      constexpr auto bitmaps = [](auto tree) {
+        std::array<rime::char_bitmap, 5> result{};
+        auto n = tree.nodes[tree.root].child;
+        for (auto& bitmap : result) {
+          bitmap = rime::detail::node_bitmap(tree, tree.nodes[n]);
+          n = tree.nodes[n].sibling;
+        }
+        return result;
+      }(rime::parse<R"([a-z0-9_]\d\s\W[^\x41-\x5A\cM])">());
+      constexpr auto bitmap = [=](std::size_t i) { return bitmaps[i]; };
+
+      static_assert(bitmap(0).test('a') and bitmap(0).test('z') and bitmap(0).test('5') and bitmap(0).test('_'));
+      static_assert(not bitmap(0).test('A') and not bitmap(0).test('-'));
+      static_assert(bitmap(1).test('0') and not bitmap(1).test('a'));
+      static_assert(bitmap(2).test(' ') and bitmap(2).test('\t') and not bitmap(2).test('x'));
+      static_assert(bitmap(3).test('-') and bitmap(3).test(0xFF) and not bitmap(3).test('w'));
+      static_assert(bitmap(4).test('a') and bitmap(4).test(0x80) and not bitmap(4).test('Q') and not bitmap(4).test('\r'));
+    }
+#if defined(__AVX2__) && !defined(RIME_NO_SIMD)
+    // -mavx2でビルドした時はAVX2の判定を使う
+    ut::expect(&rime::detail::find_in_class<true> == &rime::detail::simd_avx2::find_in_class<true>);
+#endif
+    {
+      // SIMDの判定と1文字ずつの判定が一致する
+      std::string input;
+      for (std::size_t i = 0; i < 1000; ++i) {
+        input.push_back(char((i * 37 + i / 7) % 256));
+      }
+
+      constexpr auto tree = rime::parse<R"([a-z\x80-\x90\xFE]\d\W)">();
+      for (auto n = tree.nodes[tree.root].child; n != rime::syntax_node::npos; n = tree.nodes[n].sibling) {
+        const rime::detail::byte_classifier cls = rime::detail::node_bitmap(tree, tree.nodes[n]);
+
+        for (std::size_t from = 0; from < 64; from += 5) {
+          const auto* first = input.data() + from;
+          const auto* last = input.data() + input.size();
+
+          const auto* member = std::find_if(first, last, [&](char c) { return cls.bitmap.test(static_cast<unsigned char>(c)); });
+          const auto* not_member = std::find_if(first, last, [&](char c) { return not cls.bitmap.test(static_cast<unsigned char>(c)); });
+
+          ut::expect(rime::detail::find_in_class<true>(cls, first, last) == member) << from;
+          ut::expect(rime::detail::find_in_class<false>(cls, first, last) == not_member) << from;
+        }
+      }
+    }
+    {
+      const std::string digits(100, '7');
+      const auto input = "id: " + digits + "x";
+
+      auto m = rime::static_regex<R"(\d+)">::search(input);
+      ut::expect(m.position() == 4_ull);
+      ut::expect(m.length() == 100_ull);
+      ut::expect(rime::static_regex<R"([a-z]+\d{4})">::search("ABC abcd2024").str() == "abcd2024"sv);
+    }
+  };
+
+  "backtracking hazard"_test = [] {
+    using rime::detail::hazard_kind;
+    constexpr auto hazard = [](auto tree) { return rime::detail::find_backtracking_hazard(tree).kind; };
+
+    static_assert(hazard(rime::parse<R"((a+)+$)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((a*)*b)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((\w+\s?)*$)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((?:x+x+)+y)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((\w|\d)*x)">()) == hazard_kind::ambiguous_alternation);
+    static_assert(hazard(rime::parse<R"((?:a|ab)+)">()) == hazard_kind::ambiguous_alternation);
+    static_assert(hazard(rime::parse<LR"((.|\u3042)*)">()) == hazard_kind::ambiguous_alternation);
+    static_assert(hazard(rime::parse<R"((a+){1,30}$)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((a{1,2})+$)">()) == hazard_kind::nested_quantifier);
+    static_assert(hazard(rime::parse<R"((a?a)*$)">()) == hazard_kind::overlapping_sequence);
+    static_assert(hazard(rime::parse<R"((.*,)*x)">()) == hazard_kind::overlapping_sequence);
+    static_assert(hazard(rime::parse<R"((?:a|x(b|c+)c)*)">()) == hazard_kind::overlapping_sequence);
+
+    static_assert(hazard(rime::parse<R"((ab+)+)">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"((a|b)*c)">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"(\d+-\d+)">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"((a+){3})">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<LR"(([^a]|\u3042)*)">()) == hazard_kind::ambiguous_alternation);
+    static_assert(hazard(rime::parse<LR"(([a-z]|\u3042)*)">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"((\w+,)*x)">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"((?:\d{1,3}\.){3}\d{1,3})">()) == hazard_kind::none);
+    static_assert(hazard(rime::parse<R"((?:\s*,\s*\w+)*)">()) == hazard_kind::none);
+
+    // 検出されたパターンは線形時間のエンジンで照合する
+    static_assert(std::same_as<decltype(rime::regex<R"((a+)+$)">()), rime::pike_regex<R"((a+)+$)">>);
+    static_assert(std::same_as<decltype(rime::regex<R"((a|b)*c)">()), rime::compiled_regex<R"((a|b)*c)">>);
+
+    const auto re = rime::regex<R"((a+)+$)">();
+    const auto input = std::string(5000, 'a') + "b";
+    ut::expect(not re.search(input));
+    ut::expect(re.search(input + "a").position() == 5001_ull);
+
+    static_assert(std::same_as<decltype(rime::regex<R"((a?a)*$)">()), rime::pike_regex<R"((a?a)*$)">>);
+    ut::expect(rime::regex<R"((a?a)*$)">().search(input).position() == input.size());
+    ut::expect(not rime::regex<R"((a+){1,30}$)">().search(input));
+  };
+
+  "pike_regex"_test = [] {
+    {
+      using re = rime::pike_regex<R"((\w+)@(\w+)\.com)">;
+
+      constexpr auto m = re::search("mail: foo@bar.com!");
+      static_assert(m);
+      ut::expect(m.str() == "foo@bar.com"sv);
+      ut::expect(m[1] == "foo"sv);
+      ut::expect(m[2] == "bar"sv);
+      ut::expect(not re::match("mail: foo@bar.com!"));
+      ut::expect(bool(re::match("foo@bar.com")));
+
+      static_assert(rime::pike_regex<LR"([[:alpha:]]+\d\u3042)">::match(L"abc1\u3042"));
+    }
+    {
+      // std::regex_searchと同じマッチと部分マッチになる
+      const auto check = [](const auto& re, std::string_view pattern, std::string_view input) {
+        std::match_results<const char*> expect;
+        const bool found = std::regex_search(input.data(), input.data() + input.size(), expect, std::regex(pattern.data(), pattern.size()));
+        const auto m = re.search(input);
+
+        ut::expect(bool(m) == found) << pattern << input;
+        if (not found or not m) return;
+
+        for (std::size_t i = 0; i < m.size(); ++i) {
+          ut::expect(m.matched(i) == expect[i].matched) << pattern << input << i;
+          if (m.matched(i) and expect[i].matched) {
+            ut::expect(m.position(i) == std::size_t(expect.position(i))) << pattern << input << i;
+            ut::expect(m.length(i) == std::size_t(expect.length(i))) << pattern << input << i;
+          }
+        }
+      };
+
+      std::string_view inputs[] = {"", "a", "ab", "abcd", "xabcdd", "aab b", "ba ab", "abab", "cab", "a-b", "bbbc"};
+      for (const auto input : inputs) {
+        check(rime::pike_regex<R"((a|ab)(c|bcd)(d*))">{}, R"((a|ab)(c|bcd)(d*))", input);
+        check(rime::pike_regex<R"((a+?)(b*))">{}, R"((a+?)(b*))", input);
+        check(rime::pike_regex<R"(\bab?\b)">{}, R"(\bab?\b)", input);
+        check(rime::pike_regex<R"(\Bb|^b|c$)">{}, R"(\Bb|^b|c$)", input);
+        check(rime::pike_regex<R"((b{1,2})(b?)c)">{}, R"((b{1,2})(b?)c)", input);
+        check(rime::pike_regex<R"([^a]*$)">{}, R"([^a]*$)", input);
+      }
+    }
+    {
+      // 繰り返しの中のキャプチャは、ECMAScriptと同じく繰り返しごとに未設定に戻る（libstdc++のstd::regexとは異なる）
+      const auto m1 = rime::pike_regex<R"((?:a|(b))+)">::match("ba");
+      ut::expect(bool(m1));
+      ut::expect(not m1.matched(1));
+
+      const auto m2 = rime::pike_regex<R"((?:(a)|(b))+)">::match("ab");
+      ut::expect(not m2.matched(1));
+      ut::expect(m2[2] == "b"sv);
+
+      // ECMAScriptの仕様の例
+      const auto m3 = rime::pike_regex<R"((z)((a+)?(b+)?(c))*)">::match("zaacbbbcac");
+      ut::expect(m3[1] == "z"sv);
+      ut::expect(m3[2] == "ac"sv);
+      ut::expect(m3[3] == "a"sv);
+      ut::expect(not m3.matched(4));
+      ut::expect(m3[5] == "c"sv);
+
+      static_assert(not rime::pike_regex<R"((?:a|(b)){2})">::match("ba").matched(1));
+      static_assert(rime::pike_regex<R"((?:a|(b)){2})">::match("ab").matched(1));
+    }
+  };
+
+  "pattern_info"_test = [] {
+    {
+      constexpr rime::pattern_info info{R"(^(\w+)@(\w+)\.com$)"};
+      static_assert(info.capture_group_count == 2);
+      static_assert(info.submatch_count() == 3);
+      static_assert(info.min_length == 7);
+      static_assert(info.max_length == rime::pattern_info::npos);
+      static_assert(info.anchored_begin and info.anchored_end);
+      static_assert(not info.has_back_reference and not info.has_lookahead and not info.has_word_boundary);
+      static_assert(not info.backtracking_hazard);
+      static_assert(info.nfa_state_count == rime::detail::compile_nfa(rime::parse<R"(^(\w+)@(\w+)\.com$)">()).insts.size());
+    }
+    {
+      constexpr rime::pattern_info info{R"((?:ab|c){2,3}(?=x)\b(\d)\1)"};
+      static_assert(info.capture_group_count == 1);
+      static_assert(info.min_length == 3);
+      static_assert(info.max_length == rime::pattern_info::npos);
+      static_assert(not info.anchored_begin and not info.anchored_end);
+      static_assert(info.has_back_reference and info.has_lookahead and info.has_word_boundary);
+
+      static_assert(rime::pattern_info{"a{2,5}|b"}.max_length == 5);
+      static_assert(rime::pattern_info{"^a|^b"}.anchored_begin);
+      static_assert(not rime::pattern_info{"^a|b"}.anchored_begin);
+      static_assert(rime::pattern_info{R"((a+)+$)"}.backtracking_hazard);
+      static_assert(rime::pattern_info{L"\u3042(\u3044)"}.capture_group_count == 1);
+
+      // NFAの状態数の見積もりはstatic_dfaやpike_regexの生成するNFAと一致する
+      static_assert(rime::pattern_info{"(a|bc)*d{2,4}[x-z]+"}.nfa_state_count == rime::detail::compile_nfa(rime::parse<"(a|bc)*d{2,4}[x-z]+">()).insts.size());
+    }
+  };
+
+  "start filter"_test = [] {
+    {
+      constexpr auto f1 = rime::detail::make_start_filter(rime::parse<R"((?:x|[0-9])+a|y?z)">());
+      static_assert(not f1.anchored and f1.has_first);
+      static_assert(f1.first.bitmap.test('x') and f1.first.bitmap.test('5') and f1.first.bitmap.test('y') and f1.first.bitmap.test('z'));
+      static_assert(not f1.first.bitmap.test('a'));
+
+      static_assert(rime::detail::make_start_filter(rime::parse<R"(^ab|^c)">()).anchored);
+      static_assert(not rime::detail::make_start_filter(rime::parse<R"(a*)">()).has_first);
+      static_assert(not rime::detail::make_start_filter(rime::parse<R"([^a]|a)">()).has_first);
+      static_assert(not rime::detail::make_start_filter(rime::parse<LR"(ab)">()).has_first);
+
+      static_assert(f1.next("aaa1a"sv, 0) == 3);
+      static_assert(f1.next("aaa1a"sv, 4) == rime::syntax_node::npos);
+      static_assert(rime::detail::make_start_filter(rime::parse<R"(^a)">()).next("aaa"sv, 1) == rime::syntax_node::npos);
+    }
+    {
+      // 開始位置を絞り込んでも結果は変わらない
+      const auto check = [](const auto& re, std::string_view pattern, std::string_view input, std::size_t from) {
+        std::match_results<const char*> expect;
+        const auto flags = from == 0 ? std::regex_constants::match_default : std::regex_constants::match_prev_avail;
+        const bool found = std::regex_search(input.data() + from, input.data() + input.size(), expect, std::regex(pattern.data(), pattern.size()), flags);
+        const auto m = re.search(input, from);
+
+        ut::expect(bool(m) == found) << pattern << input << from;
+        if (found and m) {
+          ut::expect(m.position() == from + std::size_t(expect.position(0))) << pattern << input << from;
+          ut::expect(m.length() == std::size_t(expect.length(0))) << pattern << input << from;
+        }
+      };
+
+      std::string_view inputs[] = {"", "ab", "xxab", "c1a9a", "zzz", "ab ab", "yz"};
+      for (const auto input : inputs) {
+        for (std::size_t from = 0; from <= input.size(); ++from) {
+          check(rime::static_regex<R"(^ab|y?z)">{}, R"(^ab|y?z)", input, from);
+          check(rime::static_regex<R"((?:x|[0-9])+a)">{}, R"((?:x|[0-9])+a)", input, from);
+          check(rime::compiled_regex<R"(^ab|^c)">{}, R"(^ab|^c)", input, from);
+          check(rime::compiled_regex<R"([0-9]a)">{}, R"([0-9]a)", input, from);
+          check(rime::compiled_regex<R"((?:x|[0-9])+a)">{}, R"((?:x|[0-9])+a)", input, from);
+          check(rime::pike_regex<R"(^ab|y?z)">{}, R"(^ab|y?z)", input, from);
+          check(rime::pike_regex<R"((?:x|[0-9])+a)">{}, R"((?:x|[0-9])+a)", input, from);
+        }
+      }
+    }
+  };
+
+  "regex_cache"_test = [] {
+    {
+      rime::regex_cache cache{};
+
+      const auto re1 = cache.get(R"(user=(\w+))");
+      const auto re2 = cache.get(std::string(R"(user=(\w+))"));
+      ut::expect(re1 == re2);
+      ut::expect(std::regex_search("id=1 user=bob", *re1));
+
+      // フラグが異なれば別のもの
+      const auto re3 = cache.get(R"(user=(\w+))", std::regex_constants::ECMAScript | std::regex_constants::icase);
+      ut::expect(re1 != re3);
+      ut::expect(std::regex_search("USER=bob", *re3));
+
+      // ECMAScript以外の文法はチェックしない
+      ut::expect(std::regex_search("aa", *cache.get("a\\{2\\}", std::regex_constants::basic)));
+
+      const auto stats = cache.stats();
+      ut::expect(stats.hits == 1_ull);
+      ut::expect(stats.misses == 3_ull);
+      ut::expect(stats.entries == 3_ull);
+      ut::expect(0_ull < stats.memory);
+
+      ut::expect(ut::throws<std::regex_error>([&] { [[maybe_unused]] auto re = cache.get("(ab"); }));
+      ut::expect(ut::throws<std::regex_error>([&] { [[maybe_unused]] auto re = cache.get("a{2,1}"); }));
+
+      // 違反の種類はstd::regex_errorのエラーコードになる
+      const auto code_of = [&](std::string_view pattern) {
+        try {
+          [[maybe_unused]] auto re = cache.get(pattern);
+        } catch (const std::regex_error& e) {
+          return e.code();
+        }
+        return std::regex_constants::error_type{};
+      };
+      ut::expect(code_of("(ab") == std::regex_constants::error_paren);
+      ut::expect(code_of("ab)") == std::regex_constants::error_paren);
+      ut::expect(code_of("[ab") == std::regex_constants::error_brack);
+      ut::expect(code_of("*ab") == std::regex_constants::error_badrepeat);
+      ut::expect(code_of("a{2") == std::regex_constants::error_brace);
+      ut::expect(code_of(R"(\2(a))") == std::regex_constants::error_backref);
+      ut::expect(code_of(R"(\x4)") == std::regex_constants::error_escape);
+
+      cache.clear();
+      ut::expect(cache.stats().entries == 0_ull);
+      ut::expect(std::regex_search("user=x", *re1));
+    }
+    {
+      // 予算を超えたら古いものから捨てる
+      rime::regex_cache cache{1, 1};
+      const auto a = cache.get("a+");
+      [[maybe_unused]] const auto b = cache.get("b+");
+      [[maybe_unused]] const auto c = cache.get("c+");
+
+      const auto stats = cache.stats();
+      ut::expect(stats.entries == 1_ull);
+      ut::expect(stats.evictions == 2_ull);
+      ut::expect(cache.get("a+") != a);
+    }
+    {
+      rime::wregex_cache cache{};
+      ut::expect(std::regex_search(L"x\u3042\u3042", *cache.get(L"\u3042+")));
+    }
+    {
+      // 複数のスレッドから同時に使える
+      rime::regex_cache cache{1 << 16, 4};
+      std::vector<std::thread> threads;
+      std::atomic<int> found = 0;
+
+      for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+          for (int i = 0; i < 200; ++i) {
+            const auto pattern = "id" + std::to_string(i % 20) + R"(=(\d+))";
+            if (std::regex_search("x id7=42", *cache.get(pattern))) ++found;
+          }
+        });
+      }
+      for (auto& th : threads) th.join();
+
+      ut::expect(found.load() == 40_i);
+      const auto stats = cache.stats();
+      ut::expect(stats.hits + stats.misses == 800_ull);
+      ut::expect(stats.entries == 20_ull);
+    }
+  };
+
+  "static_regex_object"_test = [] {
+    // 登録だけが起動時に行われている
+    ut::expect(rime::warm_up_static_regex_objects(4) >= 3_ull);
+
+    const auto& re = rime::static_regex_object<R"((\w+)@(\w+)\.com)">();
+    ut::expect(&re == &rime::static_regex_object<R"((\w+)@(\w+)\.com)">());
+    ut::expect(re.mark_count() == 2_ull);
+
+    std::cmatch m;
+    ut::expect(std::regex_search("mail: alice@example.com", m, re));
+    ut::expect(m.str(1) == "alice");
+
+    const auto& wre = rime::static_regex_object<LR"(あ+)">();
+    ut::expect(std::regex_match(L"ああ", wre));
+
+    {
+      // 複数のスレッドから最初に呼び出しても構築は1度だけ
+      std::vector<std::thread> threads;
+      std::array<const std::regex*, 4> objects{};
+
+      for (std::size_t t = 0; t < objects.size(); ++t) {
+        threads.emplace_back([&objects, t] {
+          objects[t] = &rime::static_regex_object<"[a-z]+[0-9]">();
+        });
+      }
+      for (auto& th : threads) th.join();
+
+      ut::expect(std::ranges::count(objects, objects[0]) == 4);
+      ut::expect(std::regex_match("abc1", *objects[0]));
+    }
+  };
+
+  "regex_scan"_test = [] {
+    using pike = rime::pike_regex<R"(([a-z]+)(\d+))">;
+    using compiled = rime::compiled_regex<R"(([a-z]+)(\d+))">;
+
+    static_assert(std::ranges::input_range<rime::ranges::regex_scan_view<pike>>);
+    static_assert(not std::ranges::forward_range<rime::ranges::regex_scan_view<pike>>);
+    static_assert(std::ranges::view<rime::ranges::regex_scan_view<std::regex>>);
+
+    const auto input = "a1 bb22 ccc333 d4"sv;
+
+    auto positions = [](auto&& range) {
+      std::vector<std::pair<std::size_t, std::size_t>> result;
+      for (const auto& m : range) {
+        result.emplace_back(m.position(), m.length());
+      }
+      return result;
+    };
+
+    const auto expected = positions(rime::regex_searches(input, pike{}));
+    ut::expect(expected.size() == 4_ull);
+    ut::expect(positions(rime::regex_scan(input, pike{})) == expected);
+
+    const compiled re{};
+    ut::expect(positions(rime::regex_scan(input, re)) == expected);
+    ut::expect(positions(rime::regex_scan("xaay"sv, rime::static_regex<"a*">{})) == positions(rime::regex_searches("xaay"sv, rime::static_regex<"a*">{})));
+
+    {
+      // 一時オブジェクトのエンジン（std::regexを持つcompiled_regex、literal_regex）はviewが所有する
+      ut::expect(positions(rime::regex_searches(input, rime::regex<R"(([a-z]+)(\d+))">())) == expected);
+      ut::expect(positions(rime::regex_scan(input, compiled{})) == expected);
+      ut::expect(positions(rime::regex_searches(input, rime::regex<"bb">())) == std::vector<std::pair<std::size_t, std::size_t>>{{3, 2}});
+
+      // イテレータはviewより長く使える
+      auto it = rime::regex_searches(input, compiled{}).begin();
+      ut::expect(it->position() == 0_ull);
+      ++it;
+      ut::expect(it->position() == 3_ull);
+    }
+
+    {
+      // 最初の検索の後はメモリを確保しない
+      std::string text;
+      for (int i = 0; i < 1000; ++i) text += "ab12 ";
+
+      auto scan = rime::regex_scan(std::string_view{text}, pike{});
+      auto it = scan.begin();
+      const auto before = allocation_count.load();
+
+      std::size_t count = 0;
+      for (; it != scan.end(); ++it) {
+        ut::expect(it->length() == 4_ull);
+        ++count;
+      }
+
+      ut::expect(count == 1000_ull);
+      ut::expect(allocation_count.load() == before);
+    }
+    {
+      // std::regex版はstd::regex_iteratorと同じマッチを返す
+      const std::regex empty{"a*"};
+      const auto str = "baaacab"sv;
+
+      std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>> scanned, iterated;
+      for (const auto& m : rime::regex_scan(str, empty)) {
+        ut::expect(m.position() == m[0].first - str.data());
+        scanned.emplace_back(m.position(), m.length());
+      }
+      for (std::cregex_iterator it{str.data(), str.data() + str.size(), empty}, last; it != last; ++it) {
+        iterated.emplace_back(it->position(), it->length());
+      }
+
+      ut::expect(scanned.size() == 6_ull);
+      ut::expect(scanned == iterated);
+
+      // position()とprefix()は入力の先頭から数える
+      const std::regex digits{R"(\d+)"};
+      std::vector<std::ptrdiff_t> starts;
+      for (const auto& m : rime::regex_scan("a1b22c333"sv, digits)) {
+        starts.push_back(m.position());
+      }
+      ut::expect(starts == std::vector<std::ptrdiff_t>{1, 3, 6});
+
+      // 空のマッチの後、rimeのエンジンはECMAScriptと同じく1文字進め、std::regex_iteratorは同じ位置で空でないマッチを探し直す
+      using pair_vec = std::vector<std::pair<std::size_t, std::size_t>>;
+      ut::expect(positions(rime::regex_searches("aaa"sv, rime::static_regex<"a*?">{})) == pair_vec{{0, 0}, {1, 0}, {2, 0}, {3, 0}});
+      ut::expect(positions(rime::regex_scan("aaa"sv, rime::pike_regex<"a*?">{})) == pair_vec{{0, 0}, {1, 0}, {2, 0}, {3, 0}});
+      const std::regex lazy{"a*?"};
+      ut::expect(positions(rime::regex_scan("aaa"sv, lazy)) == pair_vec{{0, 0}, {0, 1}, {1, 0}, {1, 1}, {2, 0}, {2, 1}, {3, 0}});
+      ut::expect(positions(rime::regex_scan("a1b22c333"sv, digits)) == positions(rime::regex_searches("a1b22c333"sv, rime::static_regex<R"(\d+)">{})));
+
+      const auto word = rime::regex(R"((\w+)=(\d+))");
+      std::vector<std::string> keys;
+      for (const auto& m : rime::regex_scan("x=1, yy=22"sv, word)) {
+        keys.push_back(m.str(1));
+      }
+      ut::expect(keys == std::vector<std::string>{"x", "yy"});
+    }
+  };
+
+  "string_view submatches"_test = [] {
+    const auto line = "2024-05-01 ERROR disk full"sv;
+    const auto re = rime::regex<R"((\d+)-(\d+)-(\d+) (\w+))">();
+
+    const auto m = re.search(line);
+    ut::expect(bool(m));
+    ut::expect(m.input().data() == line.data());
+    ut::expect(m.str(4).data() == line.data() + 11);
+    ut::expect(m.end_position(4) == 16_ull);
+    ut::expect(m.suffix() == " disk full"sv);
+
+    {
+      const auto [year, month, day, level] = m.groups();
+      ut::expect(year == "2024"sv);
+      ut::expect(month == "05"sv);
+      ut::expect(day == "01"sv);
+      ut::expect(level == "ERROR"sv);
+    }
+    {
+      const auto [all, y, mo, d, level] = m;
+      ut::expect(all == "2024-05-01 ERROR"sv);
+      ut::expect(level.data() == line.data() + 11);
+      static_assert(std::same_as<decltype(level), const std::string_view>);
+    }
+    {
+      // マッチしていないグループは空
+      const auto opt = rime::pike_regex<"a(b)?(c)">::search("ac");
+      const auto [b, c] = opt.groups();
+      ut::expect(b.empty());
+      ut::expect(c == "c"sv);
+    }
+    {
+      // std::match_resultsからもコピーせずに取り出せる
+      const auto sre = rime::regex(R"((\w+)=(\d+))");
+      std::vector<std::string_view> keys;
+      keys.reserve(2);
+      for (const auto& sm : rime::regex_searches("x=1, yy=22"sv, sre)) {
+        const auto [key, value] = rime::captures<2>(sm);
+        keys.push_back(key);
+        ut::expect(rime::to_string_view(sm[0]).ends_with(value));
+      }
+      ut::expect(keys == std::vector<std::string_view>{"x", "yy"});
+    }
+  };
+
+  "regex_filter_view"_test = [] {
+    const std::vector<std::string> lines = {"GET /index.html 200", "POST /api 500", "GET /favicon.ico 404", "GET /api 200"};
+    const auto re = rime::regex(R"(^GET .* 200$)");
+
+    {
+      auto view = lines | rime::views::regex_filter(re);
+      static_assert(std::ranges::bidirectional_range<decltype(view)>);
+      static_assert(std::ranges::common_range<decltype(view)>);
+
+      std::vector<std::string> result(view.begin(), view.end());
+      ut::expect(result == std::vector<std::string>{"GET /index.html 200", "GET /api 200"});
+
+      // 逆順にも辿れる
+      ut::expect(*std::ranges::prev(view.end()) == "GET /api 200"sv);
+      ut::expect(std::ranges::distance(view) == 2);
+    }
+    {
+      // regex_matchは要素全体がマッチするものだけを残す
+      const auto api = rime::regex(R"(\w+ /api)");
+      ut::expect(std::ranges::distance(lines | rime::views::regex_filter(api)) == 2);
+      ut::expect(std::ranges::distance(lines | rime::views::regex_match_filter(api)) == 0);
+      ut::expect(std::ranges::distance(rime::views::regex_match_filter(lines, rime::regex(R"(\w+ /api \d+)"))) == 2);
+    }
+    {
+      // viewのコピーは正規表現を共有する
+      auto shared = std::make_shared<const std::regex>("404|500");
+      auto view = rime::ranges::regex_filter_view{std::views::all(lines), shared};
+      auto copy = view;
+      ut::expect(&copy.regex() == &view.regex());
+      ut::expect(shared.use_count() == 3);
+      ut::expect(std::ranges::distance(copy) == 2);
+
+      rime::regex_cache cache{};
+      ut::expect(std::ranges::distance(lines | rime::views::regex_filter(cache.get("^POST"))) == 1);
+    }
+    {
+      // begin()はキャッシュされ、述語は先頭を求めるときに1度だけ評価される
+      int evaluated = 0;
+      auto counted = lines | std::views::transform([&](const std::string& line) -> std::string_view {
+        ++evaluated;
+        return line;
+      });
+      auto view = counted | rime::views::regex_filter(rime::regex("favicon"));
+      ut::expect(evaluated == 0_i);
+      ut::expect(*view.begin() == "GET /favicon.ico 404"sv);
+      const auto after_first = evaluated;
+      ut::expect(*view.begin() == "GET /favicon.ico 404"sv);
+      ut::expect(evaluated == after_first + 1);
+    }
+    {
+      // 入力範囲と、一時オブジェクトを返す範囲
+      std::istringstream stream{"ab\ncd\nabc\n"};
+      auto words = std::views::istream<std::string>(stream);
+      std::vector<std::string> result;
+      for (const auto& w : words | rime::views::regex_filter(rime::regex("^ab"))) {
+        result.push_back(w);
+      }
+      ut::expect(result == std::vector<std::string>{"ab", "abc"});
+
+      auto upper = lines | std::views::transform([](const std::string& line) { return line.substr(0, 4); });
+      ut::expect(std::ranges::distance(upper | rime::views::regex_match_filter(rime::regex("GET "))) == 3);
+    }
+    {
+      std::vector<std::wstring> wlines = {L"\u3042\u3044", L"\u3046"};
+      ut::expect(std::ranges::distance(wlines | rime::views::regex_filter(rime::regex(L"\u3042"))) == 1);
+    }
+  };
+
+  "regex_split"_test = [] {
+    auto fields = [](auto&& range) {
+      std::vector<std::string_view> result;
+      for (auto field : range) result.push_back(field);
+      return result;
+    };
+    using sv_vec = std::vector<std::string_view>;
+
+    const auto comma = rime::regex<R"(\s*,\s*)">();
+    ut::expect(fields(rime::regex_split("a, b ,c"sv, comma)) == sv_vec{"a", "b", "c"});
+    ut::expect(fields(rime::regex_split(",a,"sv, comma)) == sv_vec{"", "a", ""});
+    ut::expect(fields(rime::regex_split("abc"sv, comma)) == sv_vec{"abc"});
+    ut::expect(fields(rime::regex_split(""sv, comma)) == sv_vec{""});
+
+    // 一時オブジェクトのエンジン（README の例）
+    ut::expect(fields(rime::regex_split("a, b ,c", rime::regex<R"(\s*,\s*)">())) == sv_vec{"a", "b", "c"});
+    {
+      // イテレータがエンジンを所有するので、viewより長く使える
+      auto it = std::ranges::begin(rime::regex_split("a, b"sv, rime::regex<R"(\s*,\s*)">()));
+      ut::expect(*it == "a"sv);
+      ++it;
+      ut::expect(*it == "b"sv);
+    }
+
+    // 空の区切りは1文字ずつに分ける
+    ut::expect(fields(rime::regex_split("abc"sv, rime::static_regex<"x*">{})) == sv_vec{"a", "b", "c"});
+
+    // キャプチャグループを区切りの位置に挟む
+    const auto op = rime::static_regex<R"(\s*([-+])(\?)?\s*)">{};
+    ut::expect(fields(rime::regex_split("1 + 2-3"sv, op, {1})) == sv_vec{"1", "+", "2", "-", "3"});
+    ut::expect(fields(rime::regex_split("1 + 2"sv, op, {1, 2})) == sv_vec{"1", "+", "", "2"});
+
+    // 選べないグループの番号は例外になる
+    ut::expect(ut::throws<std::out_of_range>([&] { static_cast<void>(rime::regex_split("1 + 2"sv, op, {64})); }));
+    ut::expect(ut::throws<std::out_of_range>([&] { static_cast<void>(rime::regex_split("1 + 2"sv, op, {1, 0})); }));
+    ut::expect(fields(rime::regex_split("1 + 2"sv, op, {1, 63})) == sv_vec{"1", "+", "2"});
+
+    // 結果は入力を指す
+    const auto input = "key=value; x=y"sv;
+    for (auto field : rime::regex_split(input, rime::regex<"; ">())) {
+      ut::expect(input.data() <= field.data() and field.data() + field.size() <= input.data() + input.size());
+    }
+
+    // borrowed_rangeなのでviewが一時オブジェクトでも使える
+    static_assert(std::ranges::borrowed_range<rime::ranges::regex_split_view<rime::static_regex<",">>>);
+    static_assert(std::ranges::forward_range<rime::ranges::regex_split_view<std::regex>>);
+    auto it = std::ranges::find(rime::regex_split("a,b,c"sv, rime::static_regex<",">{}), "b"sv);
+    ut::expect(*it == "b"sv);
+
+    static_assert(std::ranges::distance(rime::regex_split("1,2,3,4"sv, rime::static_regex<",">{})) == 4);
+
+    auto lengths = rime::regex_split("aa bbb c"sv, rime::static_regex<" ">{}) | std::views::transform(&std::string_view::size);
+    ut::expect(std::ranges::equal(lengths, std::array<std::size_t, 3>{2, 3, 1}));
+
+    {
+      // std::regexとstd::sregex_token_iteratorとの比較
+      const std::regex re{R"(\s*(;)\s*)"};
+      const std::string str = "a ; b;c ;";
+      std::vector<std::string> expected(std::sregex_token_iterator(str.begin(), str.end(), re, {-1, 1}), std::sregex_token_iterator{});
+      expected.push_back("");
+
+      std::vector<std::string> actual;
+      for (auto field : rime::regex_split(std::string_view{str}, re, {1})) {
+        actual.emplace_back(field);
+      }
+      ut::expect(actual == expected);
+
+      const auto before = allocation_count.load();
+      std::size_t count = 0;
+      for (auto field : rime::regex_split("x,y,z"sv, rime::static_regex<",">{})) {
+        count += field.size();
+      }
+      ut::expect(count == 3_ull);
+      ut::expect(allocation_count.load() == before);
+    }
+  };
+
+  "regex_replace"_test = [] {
+    ut::expect(rime::regex_replace<R"((\w+)@(\w+)\.com)", "$2:$1">("mail alice@example.com, bob@test.com") == "mail example:alice, test:bob"sv);
+    ut::expect(rime::regex_replace<"b", "[$`|$&|$']">("abc") == "a[a|b|c]c"sv);
+    ut::expect(rime::regex_replace<"a", "$$">("banana") == "b$n$n$"sv);
+    ut::expect(rime::regex_replace<"a", "$x$">("ba") == "b$x$"sv);
+    ut::expect(rime::regex_replace<"x*", "-">("abc") == "-a-b-c-"sv);
+    ut::expect(rime::regex_replace<L"a|b", L"<$&>">(L"cab"sv) == L"c<a><b>"sv);
+
+    // std::regex_replaceと同じ結果になる
+    {
+      const std::string input = "2024-05-01 and 1999-12-31";
+      const std::regex re{R"((\d+)-(\d+)-(\d+))"};
+      ut::expect(rime::regex_replace<R"((\d+)-(\d+)-(\d+))", "$3/$2/$1 ($`)">(input) == std::regex_replace(input, re, "$3/$2/$1 ($`)"));
+      ut::expect(rime::regex_replace<R"((\d+)-(\d+)-(\d+))", "$3">(input, std::regex_constants::format_first_only) == std::regex_replace(input, re, "$3", std::regex_constants::format_first_only));
+      ut::expect(rime::regex_replace<R"((\d+)-(\d+)-(\d+))", "$1;">(input, std::regex_constants::format_no_copy) == "2024;1999;"sv);
+    }
+
+    // 空のマッチの後は1文字進める、std::regex_replaceは同じ位置で空でないマッチを試す
+    {
+      ut::expect(rime::regex_replace<"a*?", "<$&>">("aaa") == "<>a<>a<>a<>"sv);
+      ut::expect(std::regex_replace(std::string("aaa"), std::regex{"a*?"}, "<$&>") == "<><a><><a><><a><>"sv);
+    }
+
+    // 2桁の番号は、そのグループが無ければ1桁と解釈する
+    ut::expect(rime::regex_replace<"(a)", "$10">("a") == "a0"sv);
+    ut::expect(rime::regex_replace<"(a)(b)(c)(d)(e)(f)(g)(h)(i)(j)", "$10">("abcdefghij") == "j"sv);
+
+    // 書式はECMAScriptのGetSubstitutionと同じ、std::regex_replace（libstdc++）は$10を10番のグループとして空にする
+    ut::expect(rime::regex_replace<"(X)", "$1$10">("X") == "XX0"sv);
+    ut::expect(std::regex_replace(std::string("X"), std::regex{"(X)"}, "$1$10") == "X"sv);
+
+    // $0と$00はそのまま、$01は1番のグループ
+    ut::expect(rime::regex_replace<"(X)", "[$0]">("X") == "[$0]"sv);
+    ut::expect(rime::regex_replace<"(X)", "[$00]">("X") == "[$00]"sv);
+    ut::expect(rime::regex_replace<"(X)", "[$01]">("X") == "[X]"sv);
+    ut::expect(rime::regex_replace<"(X)(Y)", "[$05]">("XY") == "[$05]"sv);
+    ut::expect(rime::regex_replace<"X", "$0">("aXb") == "a$0b"sv);
+
+    // 呼び出し側のバッファに直接書き出す
+    {
+      std::array<char, 32> buffer{};
+      const auto end = rime::regex_replace<R"(\s+)", " ">(buffer.data(), "a  b\t\tc");
+      ut::expect(std::string_view(buffer.data(), end) == "a b c"sv);
+    }
+
+    // 1つのマッチの書式化
+    {
+      const auto m = rime::static_regex<R"((\w+)=(\w+))">::search("k=v");
+      std::string out;
+      rime::format_match<"$2=$1">(std::back_inserter(out), m);
+      ut::expect(out == "v=k"sv);
+    }
+  };
+
+  "regex_set"_test = [] {
+    rime::regex_set set{R"(^GET /api/\w+)", R"(^POST )", R"(\.php)", R"(\d{3}$)", "admin|root", "^$"};
+    ut::expect(set.size() == 6_ull);
+
+    auto indices = [](const rime::regex_set::bitset& bits) {
+      std::vector<std::size_t> result;
+      for (auto i : bits.indices()) result.push_back(i);
+      return result;
+    };
+
+    ut::expect(indices(set.matches("GET /api/users 200")) == std::vector<std::size_t>{0, 3});
+    ut::expect(indices(set.matches("POST /admin/index.php")) == std::vector<std::size_t>{1, 2, 4});
+    ut::expect(indices(set.matches("GET /static 2000x")) == std::vector<std::size_t>{});
+    ut::expect(indices(set.matches("")) == std::vector<std::size_t>{5});
+    ut::expect(set.is_match("x root"));
+    ut::expect(not set.is_match("nothing here"));
+    ut::expect(set.is_match("ends with 404"));
+
+    {
+      // 各パターンをstd::regex_searchで試した結果と一致する
+      const std::vector<std::string> patterns = {"a+b", "(ab|cd)e", "^x", "y$", "[0-9]{2,3}z", "a.c", "(?:q|r)+s", "\\s\\w"};
+      rime::regex_set many{patterns, 8};
+      const std::vector<std::string> inputs = {"aab", "cde", "xy", "ab", "12z", "abc", "qrqs", " w", "", "xxaabcde 123z y", "aXc\n", "\ta"};
+
+      for (const auto& input : inputs) {
+        const auto bits = many.matches(input);
+        for (std::size_t i = 0; i < patterns.size(); ++i) {
+          ut::expect(bits.test(i) == std::regex_search(input, std::regex{patterns[i]})) << input << " " << patterns[i];
+        }
+      }
+      // 状態数の上限を超えるとキャッシュを作り直す
+      ut::expect(many.cached_states() <= 8_ull);
+    }
+    {
+      // 300個のパターン
+      std::vector<std::string> patterns;
+      for (int i = 0; i < 300; ++i) patterns.push_back("/route" + std::to_string(i) + "(/|$)");
+      rime::regex_set routes{patterns};
+
+      const auto bits = routes.matches("GET /route42/x");
+      ut::expect(bits.count() == 1_ull);
+      ut::expect(bits.test(42));
+      ut::expect(routes.matches("GET /route299").test(299));
+    }
+
+    ut::expect(ut::throws([] { rime::regex_set{"a", "(b"}; }));
+    ut::expect(ut::throws([] { rime::regex_set{"a\\bc"}; }));
+    ut::expect(ut::throws([] { rime::regex_set{"(a)\\1"}; }));
+  };
+
+  "parallel_regex_searches"_test = [] {
+    auto spans = [](const auto& matches) {
+      std::vector<std::pair<std::size_t, std::size_t>> result;
+      for (const auto& m : matches) result.emplace_back(m.position(), m.length());
+      return result;
+    };
+
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+      text += "id" + std::to_string(i * 37) + "=" + std::string(std::size_t(i % 5), 'a') + " foo.bar\n";
+    }
+    const std::string_view input = text;
+
+    // チャンクの大きさとスレッド数によらず、逐次的な検索と同じ結果になる
+    auto check = [&](const auto& engine) {
+      const auto expected = spans(rime::regex_searches(input, engine));
+      for (const std::size_t chunk : {1, 2, 3, 7, 16, 100, 10000}) {
+        for (const std::size_t threads : {1, 4}) {
+          const auto actual = rime::parallel_regex_searches(input, engine, {threads, chunk});
+          ut::expect(spans(actual) == expected) << "chunk " << chunk << " threads " << threads;
+          ut::expect(actual.empty() or actual.front().input().data() == input.data());
+        }
+      }
+      return expected.size();
+    };
+
+    ut::expect(check(rime::regex<R"(\d+)">()) == 40_ull);
+    ut::expect(check(rime::regex<R"(id\d+=a*)">()) == 40_ull);
+    ut::expect(check(rime::static_regex<"a*">{}) > 40_ull);
+    ut::expect(check(rime::static_regex<R"(\b\w)">{}) > 0_ull);
+    ut::expect(check(rime::pike_regex<R"(=(a|aa)*)">{}) == 40_ull);
+    ut::expect(check(rime::regex<R"(bar\n$)">()) == 1_ull);
+    ut::expect(check(rime::static_regex<R"(\w+(?= foo))">{}) == 32_ull);
+    ut::expect(check(rime::compiled_regex<R"(a[^\n]*)">{}) > 0_ull);
+    ut::expect(check(rime::regex<"foo.bar">()) == 40_ull);
+    ut::expect(check(rime::regex<"zzz">()) == 0_ull);
+
+    const auto ids = rime::parallel_regex_searches<R"(id(\d+))">(input, {.threads = 2, .chunk_size = 64});
+    ut::expect(ids.size() == 40_ull);
+    ut::expect(ids[3].str(1) == "111"sv);
+
+    ut::expect(rime::parallel_regex_searches<"x*">(""sv).size() == 1_ull);
+
+    // record_delimiterを指定すると、各行を独立に検索した結果を繋いだものになる
+    auto check_records = [&](std::string_view records, const auto& engine) {
+      std::vector<std::pair<std::size_t, std::size_t>> expected;
+      for (std::size_t first = 0; first < records.size();) {
+        const auto end = std::min(records.find('\n', first), records.size());
+        for (const auto& m : rime::regex_searches(records.substr(first, end - first), engine)) {
+          expected.emplace_back(first + m.position(), m.length());
+        }
+        first = end + 1;
+      }
+      for (const std::size_t chunk : {1, 2, 3, 7, 16, 100, 10000}) {
+        for (const std::size_t threads : {1, 4}) {
+          const auto actual = rime::parallel_regex_searches(records, engine, {.threads = threads, .chunk_size = chunk, .record_delimiter = '\n'});
+          ut::expect(spans(actual) == expected) << "chunk " << chunk << " threads " << threads;
+          ut::expect(actual.empty() or actual.front().input().data() == records.data());
+        }
+      }
+      return expected.size();
+    };
+
+    static_assert(not rime::parallel_splittable<rime::static_regex<R"(\d+)">>);
+    static_assert(rime::parallel_splittable<rime::static_regex<R"(\d{1,4})">>);
+
+    ut::expect(check_records(input, rime::regex<R"(\d+)">()) == 40_ull);
+    ut::expect(check_records(input, rime::static_regex<"a*">{}) > 40_ull);
+    ut::expect(check_records(input, rime::pike_regex<R"(=a*.*$)">{}) == 40_ull);
+    ut::expect(check_records(input, rime::static_regex<R"(^id\d+)">{}) == 40_ull);
+    ut::expect(check_records(input, rime::static_regex<R"(\w+(?= foo))">{}) == 32_ull);
+    ut::expect(check_records(input, rime::regex<R"(bar\n)">()) == 0_ull);
+    ut::expect(check_records("a\n\nb\n", rime::static_regex<"x*">{}) == 5_ull);
+    ut::expect(check_records("aaa", rime::regex<"a+">()) == 1_ull);
+    ut::expect(check_records("", rime::regex<"x*">()) == 0_ull);
+
+    // 各マッチは入力全体を参照し、部分マッチの位置も入力全体で数える
+    const auto values = rime::parallel_regex_searches<R"(=(a*) (\w+)|(z))">(input, {.threads = 2, .chunk_size = 50, .record_delimiter = '\n'});
+    ut::expect(values.size() == 40_ull);
+    ut::expect(values[3].str(1) == "aaa"sv);
+    ut::expect(values[3].str(2) == "foo"sv);
+    ut::expect(not values[3].matched(3));
+    ut::expect(values[3].suffix().starts_with(".bar\nid148"));
+  };
+
+  "stream_searcher"_test = [] {
+    std::string text;
+    for (int i = 0; i < 50; ++i) {
+      text += "ts=" + std::to_string(1000 + i) + " level=" + (i % 3 == 0 ? "ERROR" : "info") + " msg=x" + std::string(std::size_t(i % 4), 'y') + "\n";
+    }
+    const std::string_view input = text;
+
+    // 断片の大きさによらず、入力全体を検索した結果と同じ
+    auto check = [&](auto searcher, const auto& engine) {
+      std::vector<std::pair<std::size_t, std::size_t>> expected;
+      for (const auto& m : rime::regex_searches(input, engine)) expected.emplace_back(m.position(), m.length());
+
+      for (const std::size_t chunk : {1, 2, 5, 13, 64, 100000}) {
+        std::vector<std::pair<std::size_t, std::size_t>> actual;
+        std::size_t max_buffered = 0;
+        auto on_match = [&](const auto& m, std::size_t offset) {
+          actual.emplace_back(offset + m.position(), m.length());
+        };
+
+        for (std::size_t pos = 0; pos < input.size(); pos += chunk) {
+          searcher.feed(input.substr(pos, chunk), on_match);
+          max_buffered = std::max(max_buffered, searcher.buffered());
+        }
+        searcher.finish(on_match);
+
+        ut::expect(actual == expected) << "chunk " << chunk;
+        if (chunk < 64) ut::expect(max_buffered < 64_ull) << "chunk " << chunk;
+      }
+      return expected.size();
+    };
+
+    ut::expect(check(rime::make_stream_searcher<R"(ts=\d{4})">(), rime::regex<R"(ts=\d{4})">()) == 50_ull);
+    ut::expect(check(rime::make_stream_searcher<"level=ERROR">(), rime::regex<"level=ERROR">()) == 17_ull);
+    ut::expect(check(rime::make_stream_searcher<R"(\bx(y{0,3})\n)">(), rime::regex<R"(\bx(y{0,3})\n)">()) == 50_ull);
+    ut::expect(check(rime::stream_searcher<rime::static_regex<"y*">>{{}, 8}, rime::static_regex<"y*">{}) > 50_ull);
+    ut::expect(check(rime::stream_searcher<rime::static_regex<"^ts">>{}, rime::static_regex<"^ts">{}) == 1_ull);
+    ut::expect(check(rime::stream_searcher<rime::static_regex<R"(y\n$)">>{}, rime::static_regex<R"(y\n$)">{}) == 1_ull);
+    // 上限の無いパターンは利用者が上限を与える
+    ut::expect(check(rime::make_stream_searcher<R"(msg=\w+)">(16), rime::regex<R"(msg=\w+)">()) == 50_ull);
+
+    {
+      // 先読みはマッチの後ろを読むので、max_lengthを与えてもfinish()まで確定しない
+      using engine = rime::static_regex<"a(?=b*c)">;
+      const std::string_view lookahead = "abbbbbbc abbbbx abc a ac abbbbbbbbbbbbbbbbbbc abbbbbbbbb";
+      std::vector<std::size_t> expected;
+      for (const auto& m : rime::regex_searches(lookahead, engine{})) expected.push_back(m.position());
+      ut::expect(expected.size() == 4_ull);
+
+      for (const std::size_t chunk : {1, 2, 3, 7}) {
+        rime::stream_searcher<engine> searcher{{}, 1};
+        std::vector<std::size_t> actual;
+        auto on_match = [&](const auto& m, std::size_t offset) { actual.push_back(offset + m.position()); };
+        for (std::size_t pos = 0; pos < lookahead.size(); pos += chunk) {
+          searcher.feed(lookahead.substr(pos, chunk), on_match);
+        }
+        searcher.finish(on_match);
+        ut::expect(actual == expected) << "chunk " << chunk;
+      }
+    }
+
+    {
+      // 上限が無ければ、最初の候補位置から後を保持する
+      auto searcher = rime::make_stream_searcher<R"(E\w+)">();
+      std::size_t count = 0;
+      searcher.feed("abc abc ", [&](const auto&, std::size_t) { ++count; });
+      ut::expect(searcher.buffered() <= 1_ull);
+      searcher.feed("ERROR x", [&](const auto&, std::size_t) { ++count; });
+      ut::expect(count == 0_ull);
+      searcher.finish([&](const auto& m, std::size_t offset) {
+        ++count;
+        ut::expect(offset + m.position() == 8_ull);
+        ut::expect(m.str() == "ERROR"sv);
+      });
+      ut::expect(count == 1_ull);
+    }
+  };
+
+  "grep_file"_test = [] {
+    const auto path = std::filesystem::temp_directory_path() / "rime_grep_file_test.log";
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+      text += "2024-01-" + std::to_string(10 + i % 20) + " " + (i % 7 == 0 ? "ERROR" : "INFO") + " request " + std::to_string(i) + "\n";
+    }
+    {
+      std::ofstream out{path, std::ios::binary};
+      out << text;
+    }
+
+    {
+      auto matches = rime::grep_file<R"(ERROR request (\d+))">(path);
+      const auto& file = matches.file();
+      ut::expect(file.view() == text);
+
+      const auto engine = rime::regex<R"(ERROR request (\d+))">();
+      std::size_t count = 0;
+      for (const auto& m : rime::regex_searches(std::string_view{text}, engine)) {
+        ++count;
+        ut::expect(text.compare(m.position(), m.length(), m.str()) == 0);
+      }
+      ut::expect(count == 29_ull);
+
+      // マッチはマップした領域を指し、位置はファイル先頭からのバイト位置
+      std::size_t n = 0;
+      for (const auto& m : matches) {
+        ut::expect(m.str().data() == file.data() + m.position());
+        ut::expect(m.str(1) == std::to_string(n * 7));
+        ++n;
+      }
+      ut::expect(n == count);
+
+      // ムーブしてもマップした領域は変わらない
+      const auto data = file.data();
+      const auto moved = std::move(matches);
+      ut::expect(moved.file().data() == data);
+      ut::expect(std::ranges::distance(moved) == 29_ll);
+    }
+    {
+      const std::regex re{R"(INFO request (\d+)\n)"};
+      std::size_t n = 0;
+      for (const auto& m : rime::grep_file(path, re)) {
+        ut::expect(text.compare(std::size_t(m.position()), std::size_t(m.length()), m.str()) == 0);
+        ++n;
+      }
+      ut::expect(n == 171_ull);
+      ut::expect(std::ranges::distance(rime::grep_file(path, rime::static_regex<"ERROR">{})) == 29_ll);
+      ut::expect(std::ranges::distance(rime::grep_file(path, rime::regex<R"(ERROR request \d+)">())) == 29_ll);
+    }
+
+    // 空のファイルはマップしない
+    {
+      std::ofstream{path, std::ios::binary | std::ios::trunc};
+    }
+    {
+      const auto matches = rime::grep_file<"a*">(path);
+      ut::expect(matches.file().size() == 0_ull);
+      ut::expect(std::ranges::distance(matches) == 1_ll);
+    }
+    std::filesystem::remove(path);
+
+    ut::expect(ut::throws<std::system_error>([&] { [[maybe_unused]] auto v = rime::grep_file<"a">(path); }));
+  };
+
+  "match_lines"_test = [] {
+    std::string text;
+    std::vector<std::size_t> errors;
+    for (std::size_t i = 0; i < 300; ++i) {
+      const bool error = (i % 11 == 3);
+      if (error) errors.push_back(i);
+      text += "2024-01-01 " + std::string(error ? "ERROR" : "INFO") + " worker=" + std::to_string(i % 17) + " took " + std::to_string(i * 37 % 1000) + "ms\n";
+    }
+    const std::string_view input = text;
+
+    // 行番号、位置、内容が正しく、改行を含まない
+    auto check = [&](const auto& lines, const std::vector<std::size_t>& expected) {
+      ut::expect(lines.size() == expected.size());
+      for (std::size_t i = 0; i < std::min(lines.size(), expected.size()); ++i) {
+        const auto& line = lines[i];
+        ut::expect(line.index == expected[i]);
+        ut::expect(line.text.data() == input.data() + line.position);
+        ut::expect(line.text.find('\n') == std::string_view::npos);
+        ut::expect(line.position == 0 or input[line.position - 1] == '\n');
+        ut::expect(line.position + line.text.size() == input.size() or input[line.position + line.text.size()] == '\n');
+      }
+    };
+
+    // リテラルによる絞り込みあり（compiled_regex、literal_regex）
+    check(rime::match_lines<R"(ERROR worker=\d+)">(input), errors);
+    check(rime::match_lines<"ERROR">(input), errors);
+    // 絞り込みなし
+    check(rime::match_lines(input, rime::static_regex<R"([A-Z]{5} )">{}), errors);
+    const std::regex re{"ERROR"};
+    check(rime::match_lines(input, re), errors);
+
+    // ^と$は行ごとに評価される
+    ut::expect(rime::match_lines<"^2024">(input).size() == 300_ull);
+    ut::expect(rime::match_lines<"0ms$">(input).size() == std::size_t(std::ranges::distance(rime::regex_searches(input, rime::static_regex<"0ms\n">{}))));
+    ut::expect(rime::match_lines<"\n">(input).empty());
+
+    // 末尾に改行が無い行と空行
+    {
+      const auto lines = rime::match_lines<"^a*$">("a\n\nb\naa"sv);
+      ut::expect(lines.size() == 3_ull);
+      ut::expect(lines[0].index == 0_ull and lines[0].text == "a"sv);
+      ut::expect(lines[1].index == 1_ull and lines[1].text == ""sv);
+      ut::expect(lines[2].index == 3_ull and lines[2].position == 5_ull and lines[2].text == "aa"sv);
+    }
+    ut::expect(rime::match_lines<"^">(""sv).empty());
+    ut::expect(rime::match_lines<"^">("x\n"sv).size() == 1_ull);
+
+    // 長い行を跨ぐリテラルの探索で行番号を数え損なわない
+    {
+      std::string long_lines = std::string(100, 'x') + "\n" + std::string(70, 'y') + "\n\n" + std::string(45, 'z') + " needle\n";
+      const auto lines = rime::match_lines<"needle">(std::string_view{long_lines});
+      ut::expect(lines.size() == 1_ull);
+      ut::expect(lines[0].index == 3_ull);
+      ut::expect(lines[0].text == std::string(45, 'z') + " needle");
+    }
+
+    {
+      const auto lines = rime::match_lines<L"b+">(L"ab\ncd\nbb"sv);
+      ut::expect(lines.size() == 2_ull);
+      ut::expect(lines[1].index == 2_ull and lines[1].text == L"bb"sv);
+    }
+  };
+
+  "batch_match"_test = [] {
+    std::vector<std::string> records;
+    for (std::size_t i = 0; i < 1000; ++i) {
+      records.push_back(i % 3 == 0 ? "user" + std::to_string(i) + "@example.com" : "not an email " + std::to_string(i));
+    }
+
+    // 逐次的に調べた結果と同じ
+    auto expected = [&](auto&& pred) {
+      rime::index_bitset bits(records.size());
+      for (std::size_t i = 0; i < records.size(); ++i) {
+        if (pred(records[i])) bits.set(i);
+      }
+      return bits;
+    };
+
+    const auto email = rime::regex<R"(\w+@\w+\.com)">();
+    const auto full = expected([&](const std::string& r) { return bool(email.match(r)); });
+    const auto part = expected([&](const std::string& r) { return bool(email.search(r)); });
+    ut::expect(full.count() == 334_ull);
+    ut::expect(part.count() == 334_ull);
+
+    for (const std::size_t threads : {1, 2, 5}) {
+      for (const std::size_t block_size : {1, 64, 100, 4096}) {
+        const rime::batch_policy policy{.threads = threads, .block_size = block_size};
+        ut::expect(rime::batch_match(records, email, policy) == full);
+        ut::expect(rime::batch_search(records, email, policy) == part);
+      }
+    }
+
+    // 全体のマッチと部分のマッチの違い
+    const auto digits = expected([](const std::string& r) { return r.find_first_of("0123456789") != std::string::npos; });
+    ut::expect(rime::batch_search<R"(\d)">(records, {.threads = 3, .block_size = 64}) == digits);
+    ut::expect(rime::batch_match<R"(\d)">(records).none());
+
+    // 各エンジンと、std::regex、string_viewの範囲
+    const std::vector<std::string_view> views(records.begin(), records.end());
+    ut::expect(rime::batch_match(views, rime::static_regex<R"(\w+@\w+\.com)">{}, {.threads = 4, .block_size = 128}) == full);
+    ut::expect(rime::batch_match(views, rime::pike_regex<R"(\w+@\w+\.com)">{}, {.threads = 4, .block_size = 128}) == full);
+    ut::expect(rime::batch_match(views, rime::static_dfa<R"(\w+@\w+\.com)">{}, {.threads = 4, .block_size = 128}) == full);
+    const std::regex re{R"(\w+@\w+\.com)"};
+    ut::expect(rime::batch_match(views, re, {.threads = 2}) == full);
+    ut::expect(rime::batch_search(records, re, {.threads = 2, .block_size = 64}) == part);
+
+    {
+      const auto bits = rime::batch_search<"example">(records | std::views::take(10), {.threads = 2, .block_size = 1});
+      ut::expect(bits.size() == 10_ull);
+      ut::expect(std::ranges::equal(bits.indices(), std::vector<std::size_t>{0, 3, 6, 9}));
+    }
+    ut::expect(rime::batch_match<"a">(std::vector<std::string>{}).size() == 0_ull);
+
+    // 例外は呼び出し元に伝わる
+    struct throwing_engine {
+      using char_type = char;
+      auto match(std::string_view str) const -> bool {
+        if (str == "not an email 500") throw std::runtime_error("bad record");
+        return false;
+      }
+    };
+    ut::expect(ut::throws<std::runtime_error>([&] { [[maybe_unused]] auto bits = rime::batch_match(records, throwing_engine{}, {.threads = 3, .block_size = 64}); }));
+  };
+
+  "regex_match_stream"_test = [] {
+    std::string text;
+    for (int i = 0; i < 40; ++i) {
+      text += "id=" + std::to_string(100 + i * 7) + (i % 5 == 0 ? " ERROR" : " ok") + "\n";
+    }
+    const std::string_view input = text;
+
+    // chunk文字ずつ返すreader、呼ばれた回数を数える
+    auto make_reader = [input](std::size_t chunk, std::size_t& calls) {
+      return [input, chunk, &calls, pos = std::size_t(0)]() mutable -> std::string_view {
+        ++calls;
+        const auto piece = input.substr(std::min(pos, input.size()), chunk);
+        pos += piece.size();
+        return piece;
+      };
+    };
+
+    const auto engine = rime::regex<R"(id=(\d+) ERROR)">();
+    std::vector<std::pair<std::size_t, std::string>> expected;
+    for (const auto& m : rime::regex_searches(input, engine)) expected.emplace_back(m.position(), std::string{m.str(1)});
+    ut::expect(expected.size() == 8_ull);
+
+    for (const std::size_t chunk : {1, 3, 16, 1000}) {
+      std::size_t calls = 0;
+      std::vector<std::pair<std::size_t, std::string>> actual;
+      for (const auto& m : rime::regex_match_stream<R"(id=(\d+) ERROR)">(make_reader(chunk, calls))) {
+        ut::expect(input.substr(m.position(), m.length()) == m.str());
+        actual.emplace_back(m.position(), std::string{m.str(1)});
+      }
+      ut::expect(actual == expected) << "chunk " << chunk;
+    }
+
+    // 必要になるまで読まない
+    {
+      std::size_t calls = 0;
+      auto matches = rime::regex_match_stream(make_reader(4, calls), rime::static_regex<R"(id=\d{3} ERROR)">{});
+      ut::expect(calls == 0_ull);
+
+      auto it = matches.begin();
+      ut::expect(it != std::default_sentinel);
+      ut::expect((*it).position() == 0_ull);
+      // 最初のマッチは id=100 ERROR\n の直後の改行まで読めば確定する
+      ut::expect(calls <= 5_ull);
+
+      ++it;
+      ut::expect((*it).position() == input.find("id=135"));
+      ut::expect(calls < input.size() / 4);
+    }
+
+    // 上限の無いパターンは入力の終わりで確定する
+    {
+      std::size_t calls = 0;
+      std::size_t count = 0;
+      for (const auto& m : rime::regex_match_stream(make_reader(5, calls), rime::static_regex<R"(\d+)">{})) {
+        ut::expect(m.str().size() == 3_ull);
+        ++count;
+      }
+      ut::expect(count == 40_ull);
+    }
+
+    // std::istreamから読む
+    {
+      std::istringstream in{text};
+      std::size_t count = 0;
+      for (const auto& m : rime::regex_match_stream<R"(ERROR\n)">(in)) {
+        ut::expect(input.substr(m.position(), m.length()) == "ERROR\n"sv);
+        ++count;
+      }
+      ut::expect(count == 8_ull);
+    }
+
+    // rangesのアダプタと組み合わせられる
+    {
+      std::size_t calls = 0;
+      auto ids = rime::regex_match_stream<R"(id=(\d+) ok)">(make_reader(7, calls))
+               | std::views::transform([](const auto& m) { return std::string{m.str(1)}; })
+               | std::views::take(3);
+      ut::expect(std::ranges::equal(ids, std::vector<std::string>{"107", "114", "121"}));
+    }
+
+    // reader()の例外は呼び出し元に伝わる
+    {
+      auto matches = rime::regex_match_stream<"x">([]() -> std::string_view { throw std::runtime_error("read error"); });
+      ut::expect(ut::throws<std::runtime_error>([&] { [[maybe_unused]] auto it = matches.begin(); }));
+    }
+  };
+
+  "zero allocation after warm-up"_test = [] {
+    std::string text;
+    for (int i = 0; i < 500; ++i) {
+      text += "GET /api/v" + std::to_string(i % 3) + "/users/" + std::to_string(i) + " 200\n";
+    }
+    const std::string_view input = text;
+
+    // fを2回目以降に呼んだ時、グローバルなoperator newが呼ばれない
+    auto steady = [](auto&& f) {
+      f();
+      const auto before = allocation_count.load();
+      for (int i = 0; i < 3; ++i) f();
+      return allocation_count.load() - before;
+    };
+
+    // 作業領域を持たないエンジン
+    auto count_all = [&](const auto& engine) {
+      std::size_t n = 0;
+      for (const auto& m : rime::regex_searches(input, engine)) n += m.length();
+      return n;
+    };
+    ut::expect(steady([&] { return count_all(rime::static_regex<R"(/users/\d+)">{}); }) == 0_ull);
+    ut::expect(steady([&] { return count_all(rime::literal_alternation<"GET|POST">{}); }) == 0_ull);
+    ut::expect(steady([&] { return count_all(rime::literal_set<"v0", "v1", "v2">{}); }) == 0_ull);
+    {
+      const auto literal = rime::literal_regex<"/users/">{};
+      ut::expect(steady([&] { return count_all(literal); }) == 0_ull);
+    }
+    ut::expect(steady([&] { return rime::static_dfa<R"(GET /api/v\d/users/\d+ 200)">::match("GET /api/v1/users/42 200"); }) == 0_ull);
+
+    // pike_regexは作業領域を使い回す
+    {
+      using pike = rime::pike_regex<R"((\w+)/(\d+) (\d{3}))">;
+      counting_resource resource;
+      pike::scratch_type scratch{&resource};
+      const auto constructed = resource.allocations;
+      ut::expect(0 < constructed);
+
+      const auto before = allocation_count.load();
+      std::size_t n = 0;
+      for (std::size_t from = 0; from <= input.size();) {
+        const auto m = pike{}.search(input, from, scratch);
+        if (not m) break;
+        ++n;
+        from = m.position() + m.length();
+      }
+      ut::expect(n == 500_ull);
+      ut::expect(allocation_count.load() == before);
+      ut::expect(resource.allocations == constructed);
+
+      // regex_scanに渡したresourceから作業領域を確保する
+      counting_resource scan_resource;
+      auto scan = rime::regex_scan(input, pike{}, &scan_resource);
+      ut::expect(0 < scan_resource.allocations);
+      const auto scan_before = allocation_count.load();
+      ut::expect(std::ranges::distance(scan.begin(), scan.end()) == 500_ll);
+      ut::expect(allocation_count.load() == scan_before);
+    }
+
+    // stream_searcherは断片の長さが一定なら、バッファを使い回す
+    {
+      counting_resource resource;
+      rime::stream_searcher<rime::pike_regex<R"(users/(\d+))">> searcher{{}, 16, &resource};
+      std::size_t n = 0;
+      auto on_match = [&](const auto&, std::size_t) { ++n; };
+
+      std::size_t pos = 0;
+      for (; pos < 64 * 4; pos += 64) searcher.feed(input.substr(pos, 64), on_match);
+
+      const auto before = allocation_count.load();
+      const auto warmed = resource.allocations;
+      for (; pos < input.size(); pos += 64) searcher.feed(input.substr(pos, 64), on_match);
+      searcher.finish(on_match);
+
+      ut::expect(n == 500_ull);
+      ut::expect(allocation_count.load() == before);
+      ut::expect(resource.allocations == warmed);
+    }
+  };
+
 #ifndef _MSC_VER
   "regex_searches"_test = [] {
     const auto regex = rime::regex(R"(\d+)");